@@ -0,0 +1,139 @@
+// Headless benchmark: steps every game mode on every engine from fixed seeds and grid
+// sizes and prints one CSV row per run. Built by 'make bench' with -DRAYLIB_ENABLED=0.
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../world.h"
+
+#define BENCH_GENS 32
+#define BENCH_WARMUP 4
+#define BENCH_DENSITY 0.3
+#define BENCH_SEED 1
+#define BENCH_ENGINES (ENGINES + 1)   // The sparse (unbounded) world runs as a fourth engine.
+
+struct bench_size{
+    size_t columns;
+    size_t rows;
+};
+
+const bench_size bench_sizes[] = {{256, 256}, {1920, 1040}};
+
+
+void print_usage(const char* name){
+    fprintf(stderr, "Usage: %s [--gens N] [--threads N] [--engine scalar|bitpack|simd|sparse] [--mode N] [--ages] [--pattern FILE]\n", name);
+}
+
+// FNV-1a over the final grid: equal checksums mean two engines produced the same cells.
+uint64_t checksum(const uint8_t* cells, size_t count){
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t c=0; c<count; c++){
+        h = (h ^ cells[c]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+void bench_run(int engine, int mode, const bench_size& size, int gens, size_t threads, bool ages, const char* pattern){
+    World world(size.rows + HUD_H, size.columns, 1, size.columns, size.rows);
+    world.set_ages_enabled(ages);
+    world.select_game_mode(mode);
+    if (threads){
+        world.set_threads(threads);
+    }
+    if (engine == ENGINES){
+        world.set_engine(_ENGINE_BITPACK);
+    }else{
+        world.set_engine(engine);
+    }
+    world.set_seed(BENCH_SEED + mode);
+    world.setup_cells(BENCH_DENSITY);
+    if (engine == ENGINES){
+        world.toggle_unbounded();
+    }
+    if (pattern && !world.load_pattern(pattern, PATTERN_CENTRE, PATTERN_CENTRE)){
+        fprintf(stderr, "Cannot load pattern '%s'.\n", pattern);
+        exit(1);
+    }
+    for (int g=0; g<BENCH_WARMUP; g++){
+        world.cycle();
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int g=0; g<gens; g++){
+        world.cycle();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    double updates = (double)world.get_cell_count() * gens;
+    size_t population = world.get_stats().population;
+    const uint8_t* cells = world.get_cells();
+    // Larger-than-Life rule names hold commas, so they are quoted.
+    const char* quote = strchr(world.get_rule_name(), ',') ? "\"" : "";
+    printf("%s,%s%s%s,%ld,%ld,%ld,%d,%.6f,%.1f,%.0f,%.3f,%ld,%016lx\n",
+           world.get_engine_name(), quote, world.get_rule_name(), quote, world.get_columns(), world.get_rows(),
+           world.get_threads(), gens, seconds, gens / seconds, updates / seconds,
+           (seconds * 1e9) / updates, population, checksum(cells, world.get_cell_count()));
+    fflush(stdout);
+}
+
+int main(int argc, char** argv){
+    int gens = BENCH_GENS;
+    size_t threads = 0;
+    int only_engine = -1;
+    int only_mode = -1;
+    bool ages = false;
+    const char* pattern = NULL;
+    for (int i=1; i<argc; i++){
+        if (strcmp(argv[i], "--gens") == 0 && i + 1 < argc){
+            gens = atoi(argv[++i]);
+        }else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+            threads = atoi(argv[++i]);
+        }else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc){
+            const char* names[BENCH_ENGINES] = {"scalar", "bitpack", "simd", "sparse"};
+            i++;
+            for (int e=0; e<BENCH_ENGINES; e++){
+                if (strcmp(argv[i], names[e]) == 0){
+                    only_engine = e;
+                }
+            }
+            if (only_engine < 0){
+                print_usage(argv[0]);
+                return 1;
+            }
+        }else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc){
+            only_mode = atoi(argv[++i]) % MODES;
+        }else if (strcmp(argv[i], "--ages") == 0){
+            ages = true;
+        }else if (strcmp(argv[i], "--pattern") == 0 && i + 1 < argc){
+            pattern = argv[++i];
+        }else{
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (gens < 1){
+        gens = 1;
+    }
+    // A pattern replaces the random soup; a rule in its header replaces the mode, so
+    // without --mode it runs once rather than once per mode.
+    if (pattern && only_mode < 0){
+        only_mode = 0;
+    }
+
+    printf("engine,rule,columns,rows,threads,generations,seconds,gens_per_s,cell_updates_per_s,ns_per_cell,population,checksum\n");
+    for (const bench_size& size : bench_sizes){
+        for (int mode=0; mode<MODES; mode++){
+            if (only_mode >= 0 && mode != only_mode){
+                continue;
+            }
+            for (int engine=0; engine<BENCH_ENGINES; engine++){
+                if (only_engine >= 0 && engine != only_engine){
+                    continue;
+                }
+                bench_run(engine, mode, size, gens, threads, ages, pattern);
+            }
+        }
+    }
+    return 0;
+}
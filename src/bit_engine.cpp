@@ -0,0 +1,121 @@
+#include "bit_engine.h"
+
+#include <string.h>
+
+
+BitEngine::BitEngine() :
+        m_columns(0), m_rows(0), m_words(0), m_tail_bits(0), m_tail_mask(0),
+        m_row_value_a(nullptr), m_row_value_b(nullptr), m_cycle_turn(0)
+    {
+        m_row_values[0] = nullptr;
+        m_row_values[1] = nullptr;
+}
+
+BitEngine::~BitEngine(){
+        delete[] m_row_value_a;
+        delete[] m_row_value_b;
+}
+
+void BitEngine::resize(size_t columns, size_t rows){
+        delete[] m_row_value_a;
+        delete[] m_row_value_b;
+        m_columns = columns;
+        m_rows = rows;
+        m_words = (columns + 63) / 64;
+        m_tail_bits = columns - ((m_words - 1) * 64);
+        m_tail_mask = (m_tail_bits == 64) ? ~(uint64_t)0 : (((uint64_t)1 << m_tail_bits) - 1);
+        m_row_value_a = new uint64_t[m_words * m_rows]();
+        m_row_value_b = new uint64_t[m_words * m_rows]();
+        m_row_values[0] = m_row_value_a;
+        m_row_values[1] = m_row_value_b;
+        m_cycle_turn = 0;
+}
+
+void BitEngine::load(const uint8_t* cells){
+        uint64_t* dst = m_row_values[m_cycle_turn];
+        for (size_t y=0; y<m_rows; y++){
+            const uint8_t* src = cells + (y * m_columns);
+            uint64_t* row = dst + (y * m_words);
+            for (size_t i=0; i<m_words; i++){
+                size_t x0 = i * 64;
+                size_t n = (i == m_words - 1) ? m_tail_bits : 64;
+                uint64_t w = 0;
+                for (size_t b=0; b<n; b++){
+                    w |= (uint64_t)(src[x0 + b] & 1) << b;
+                }
+                row[i] = w;
+            }
+        }
+}
+
+// Takes rows that are already packed in this engine's layout, e.g. from a state file.
+void BitEngine::load_words(const uint64_t* words){
+        memcpy(m_row_values[m_cycle_turn], words, m_words * m_rows * sizeof(uint64_t));
+}
+
+// Computes the next state of words [i0, i1) of one row, wrapping across the padded last word.
+void BitEngine::step_row(size_t y, size_t i0, size_t i1, const uint8_t* counts, size_t count_n, uint16_t birth, uint16_t survive){
+        const uint64_t* cur = m_row_values[m_cycle_turn];
+        uint64_t* nxt = m_row_values[!m_cycle_turn] + (y * m_words);
+        const uint64_t* up = cur + (((y + m_rows - 1) % m_rows) * m_words);
+        const uint64_t* mid = cur + (y * m_words);
+        const uint64_t* dn = cur + (((y + 1) % m_rows) * m_words);
+        const size_t last = m_words - 1;
+        const size_t top_bit = m_tail_bits - 1;
+
+        for (size_t i=i0; i<i1; i++){
+            uint64_t u = up[i], m = mid[i], d = dn[i];
+            uint64_t uw, mw, dw, ue, me, de;
+            if (i == 0){
+                uw = (u << 1) | ((up[last] >> top_bit) & 1);
+                mw = (m << 1) | ((mid[last] >> top_bit) & 1);
+                dw = (d << 1) | ((dn[last] >> top_bit) & 1);
+            }else{
+                uw = (u << 1) | (up[i-1] >> 63);
+                mw = (m << 1) | (mid[i-1] >> 63);
+                dw = (d << 1) | (dn[i-1] >> 63);
+            }
+            if (i == last){
+                ue = (u >> 1) | ((up[0] & 1) << top_bit);
+                me = (m >> 1) | ((mid[0] & 1) << top_bit);
+                de = (d >> 1) | ((dn[0] & 1) << top_bit);
+            }else{
+                ue = (u >> 1) | (up[i+1] << 63);
+                me = (m >> 1) | (mid[i+1] << 63);
+                de = (d >> 1) | (dn[i+1] << 63);
+            }
+
+            uint64_t w = life_word(uw, u, ue, mw, m, me, dw, d, de, counts, count_n, birth, survive);
+            if (i == last){
+                w &= m_tail_mask;
+            }
+            nxt[i] = w;
+        }
+}
+
+// Steps words [i0, i1) of rows [y0, y1) into the off buffer. Spans are independent, so
+// disjoint ones may run on different threads before a single swap().
+void BitEngine::step_span(size_t y0, size_t y1, size_t i0, size_t i1, uint16_t birth, uint16_t survive){
+        uint8_t counts[9];
+        size_t count_n = rule_counts(birth, survive, counts);
+        for (size_t y=y0; y<y1; y++){
+            step_row(y, i0, i1, counts, count_n, birth, survive);
+        }
+}
+
+void BitEngine::swap(){
+        m_cycle_turn = !m_cycle_turn;
+}
+
+size_t BitEngine::get_row_words(){
+        return m_words;
+}
+
+// The current generation's rows, and the next one's while a step is under way.
+const uint64_t* BitEngine::get_rows(){
+        return m_row_values[m_cycle_turn];
+}
+
+const uint64_t* BitEngine::get_next_rows(){
+        return m_row_values[!m_cycle_turn];
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+static inline void full_add(uint64_t* sum, uint64_t* carry, uint64_t a, uint64_t b, uint64_t c){
+    uint64_t ab = a ^ b;
+    *sum = ab ^ c;
+    *carry = (a & b) | (c & ab);
+}
+
+// Lists the neighbour counts that appear in birth | survive; life_word() only tests those.
+static inline size_t rule_counts(uint16_t birth, uint16_t survive, uint8_t* counts){
+    size_t count_n = 0;
+    for (uint8_t n=0; n<9; n++){
+        if (((birth | survive) >> n) & 1){
+            counts[count_n++] = n;
+        }
+    }
+    return count_n;
+}
+
+// Next state of 64 cells from their row (m) and the rows above (u) and below (d), each also
+// shifted to give the west (..w) and east (..e) neighbour. Neighbour counts are built as four
+// bit-planes (s0..s3) with a carry-save adder tree; the rule is then applied per count value.
+static inline uint64_t life_word(uint64_t uw, uint64_t u, uint64_t ue, uint64_t mw, uint64_t m, uint64_t me,
+                                 uint64_t dw, uint64_t d, uint64_t de,
+                                 const uint8_t* counts, size_t count_n, uint16_t birth, uint16_t survive){
+    uint64_t su, cu, sd, cd, s0, c1, ts, tc;
+    full_add(&su, &cu, uw, u, ue);
+    full_add(&sd, &cd, dw, d, de);
+    uint64_t sm = mw ^ me;
+    uint64_t cm = mw & me;
+    full_add(&s0, &c1, su, sd, sm);
+    full_add(&ts, &tc, cu, cd, cm);
+    uint64_t s1 = ts ^ c1;
+    uint64_t c2 = ts & c1;
+    uint64_t s2 = tc ^ c2;
+    uint64_t s3 = tc & c2;
+
+    uint64_t born = 0, kept = 0;
+    for (size_t k=0; k<count_n; k++){
+        uint8_t n = counts[k];
+        uint64_t eq = ~(s0 ^ (0 - (uint64_t)(n & 1)))
+                    & ~(s1 ^ (0 - (uint64_t)((n >> 1) & 1)))
+                    & ~(s2 ^ (0 - (uint64_t)((n >> 2) & 1)))
+                    & ~(s3 ^ (0 - (uint64_t)((n >> 3) & 1)));
+        born |= eq & (0 - (uint64_t)((birth >> n) & 1));
+        kept |= eq & (0 - (uint64_t)((survive >> n) & 1));
+    }
+    return (born & ~m) | (kept & m);
+}
+
+
+// Bit-packed simulation engine: 64 cells per uint64_t, one row padded to whole words.
+// Bit b of word i in a row holds the cell at column 64*i + b. While it is World's engine
+// these rows are the grid; the byte grid is only unpacked from them when something reads it.
+class BitEngine{
+    private:
+        size_t m_columns;
+        size_t m_rows;
+        size_t m_words;
+        size_t m_tail_bits;
+        uint64_t m_tail_mask;
+        uint64_t* m_row_value_a;
+        uint64_t* m_row_value_b;
+        uint8_t m_cycle_turn;
+        uint64_t* m_row_values[2];
+
+        void step_row(size_t y, size_t i0, size_t i1, const uint8_t* counts, size_t count_n, uint16_t birth, uint16_t survive);
+
+    public:
+        BitEngine();
+        ~BitEngine();
+        void resize(size_t columns, size_t rows);
+        void load(const uint8_t* cells);
+        void load_words(const uint64_t* words);
+        void step_span(size_t y0, size_t y1, size_t i0, size_t i1, uint16_t birth, uint16_t survive);
+        void swap();
+        size_t get_row_words();
+        const uint64_t* get_rows();
+        const uint64_t* get_next_rows();
+};
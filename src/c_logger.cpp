@@ -1,31 +1,244 @@
 //c_logger.c
 #include "c_logger.h"
 
-time_t timer;
-struct tm* tm_info;
-char time_stamp[26];
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdarg.h>
+#include <string.h>
+#include <thread>
 
 const char* levels[] = {"CRITICAL", "ERROR", "WARNING", "INFO", "DEBUG", "NOTSET"};
 
+enum log_targets{
+    _LOG_MAIN,
+    _LOG_ERROR,
+    _LOG_NODE_STATE,
+    _LOG_TARGETS
+};
+
+// One slot of the ring. seq implements a bounded multi-producer queue: a slot is free for
+// the producer holding ticket t when seq == t, and ready for the flusher when seq == t + 1.
+struct log_entry{
+    std::atomic<size_t> seq;
+    time_t time;
+    int8_t level;
+    uint8_t target;
+    char text[LOG_MESSAGE_LEN];
+};
+
+
+// Producers never lock or touch a file: they claim a slot with one compare-exchange and
+// format into it. A flusher thread drains the ring every LOG_FLUSH_MS into files it keeps
+// open. A full ring drops the message and counts it rather than stalling the caller.
+class LogRing{
+    private:
+        log_entry m_entries[LOG_RING_SIZE];
+        std::atomic<size_t> m_write;
+        size_t m_read;
+        std::atomic<size_t> m_dropped;
+        std::atomic<size_t> m_flushed;      // Tickets written out so far.
+        FILE* m_files[_LOG_TARGETS];
+        bool m_open_failed[_LOG_TARGETS];
+        int m_index[_LOG_TARGETS];
+        time_t m_stamp_time;
+        char m_stamp[26];
+        std::mutex m_mutex;
+        std::mutex m_drain_mutex;
+        std::condition_variable m_wake_cv;
+        bool m_quit;
+        std::thread m_flusher;
+
+        void flusher_loop(){
+                std::unique_lock<std::mutex> lock(m_mutex);
+                while (!m_quit){
+                    m_wake_cv.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_MS));
+                    lock.unlock();
+                    drain();
+                    lock.lock();
+                }
+                lock.unlock();
+                drain();
+        }
+
+        FILE* file(int target){
+                static const char* names[_LOG_TARGETS] = {LOGFILE, ERROR_LOGFILE, NODE_STATE_DATA_LOGFILE};
+                if (!m_files[target] && !m_open_failed[target]){
+                    m_files[target] = fopen(names[target], "a");
+                    if (m_files[target] == NULL){
+                        printf("File write error\n");
+                        m_open_failed[target] = true;
+                    }
+                }
+                return m_files[target];
+        }
+
+        // localtime/strftime only run when the second changes.
+        const char* stamp(time_t t){
+                if (t != m_stamp_time){
+                    struct tm tm_info;
+                    localtime_r(&t, &tm_info);
+                    strftime(m_stamp, sizeof(m_stamp), "%Y-%m-%d %H:%M:%S", &tm_info);
+                    m_stamp_time = t;
+                }
+                return m_stamp;
+        }
+
+        void write_entry(const log_entry& e){
+                FILE* f = file(e.target);
+                if (f == NULL){
+                    return;
+                }
+                switch (e.target){
+                    case _LOG_MAIN:
+                        fprintf(f, "%d [%s] %s: %s\n", m_index[e.target], stamp(e.time), levels[e.level], e.text);
+                        break;
+                    case _LOG_ERROR:
+                        fprintf(f, "(%d) %s\n", m_index[e.target], e.text);
+                        break;
+                    default:
+                        fprintf(f, "%s\n", e.text);
+                        break;
+                }
+                m_index[e.target]++;
+        }
+
+        // Only the flusher (or logger_flush() under m_drain_mutex) consumes.
+        void drain(){
+                std::lock_guard<std::mutex> lock(m_drain_mutex);
+                bool wrote = false;
+                while (true){
+                    log_entry& e = m_entries[m_read & (LOG_RING_SIZE - 1)];
+                    if (e.seq.load(std::memory_order_acquire) != m_read + 1){
+                        break;
+                    }
+                    write_entry(e);
+                    e.seq.store(m_read + LOG_RING_SIZE, std::memory_order_release);
+                    m_read++;
+                    wrote = true;
+                }
+                size_t dropped = m_dropped.exchange(0);
+                if (dropped && file(_LOG_MAIN)){
+                    fprintf(file(_LOG_MAIN), "%d [%s] %s: logger: %ld messages dropped.\n", m_index[_LOG_MAIN]++, stamp(time(NULL)), levels[2], dropped);
+                    wrote = true;
+                }
+                if (wrote){
+                    for (int t=0; t<_LOG_TARGETS; t++){
+                        if (m_files[t]){
+                            fflush(m_files[t]);
+                        }
+                    }
+                }
+                m_flushed.store(m_read, std::memory_order_release);
+        }
+
+    public:
+        LogRing() :
+                m_write(0), m_read(0), m_dropped(0), m_flushed(0), m_stamp_time(0), m_quit(false)
+            {
+                for (size_t i=0; i<LOG_RING_SIZE; i++){
+                    m_entries[i].seq.store(i, std::memory_order_relaxed);
+                }
+                for (int t=0; t<_LOG_TARGETS; t++){
+                    m_files[t] = NULL;
+                    m_open_failed[t] = false;
+                    m_index[t] = 0;
+                }
+                m_stamp[0] = '\0';
+                m_flusher = std::thread(&LogRing::flusher_loop, this);
+        }
+
+        ~LogRing(){
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_quit = true;
+                }
+                m_wake_cv.notify_all();
+                m_flusher.join();
+                for (int t=0; t<_LOG_TARGETS; t++){
+                    if (m_files[t]){
+                        fclose(m_files[t]);
+                    }
+                }
+        }
+
+        // Returns the claimed slot, or nullptr when the ring is full.
+        log_entry* claim(){
+                size_t ticket = m_write.load(std::memory_order_relaxed);
+                while (true){
+                    log_entry& e = m_entries[ticket & (LOG_RING_SIZE - 1)];
+                    size_t seq = e.seq.load(std::memory_order_acquire);
+                    if (seq == ticket){
+                        if (m_write.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed)){
+                            return &e;
+                        }
+                    }else if (seq < ticket){
+                        m_dropped.fetch_add(1, std::memory_order_relaxed);
+                        return nullptr;
+                    }else{
+                        ticket = m_write.load(std::memory_order_relaxed);
+                    }
+                }
+        }
+
+        // Bursts wake the flusher every half ring instead of waiting for the next tick.
+        void publish(log_entry* e){
+                size_t ticket = e->seq.load(std::memory_order_relaxed);
+                e->seq.store(ticket + 1, std::memory_order_release);
+                if ((ticket & ((LOG_RING_SIZE / 2) - 1)) == (LOG_RING_SIZE / 2) - 1){
+                    m_wake_cv.notify_one();
+                }
+        }
+
+        void flush(){
+                size_t target = m_write.load(std::memory_order_acquire);
+                while (m_flushed.load(std::memory_order_acquire) < target){
+                    drain();
+                    if (m_flushed.load(std::memory_order_acquire) < target){
+                        std::this_thread::yield();
+                    }
+                }
+        }
+};
+
+// Built on first use, so logging works from other static constructors.
+static LogRing& log_ring(){
+    static LogRing ring;
+    return ring;
+}
+
+static int log_push(int target, int level, const char* format, va_list args){
+    log_entry* e = log_ring().claim();
+    if (e == nullptr){
+        return -1;
+    }
+    e->time = time(NULL);
+    e->level = level;
+    e->target = target;
+    vsnprintf(e->text, LOG_MESSAGE_LEN, format, args);
+    log_ring().publish(e);
+    return 0;
+}
+
+static int log_push_text(int target, int level, const char* text){
+    log_entry* e = log_ring().claim();
+    if (e == nullptr){
+        return -1;
+    }
+    e->time = time(NULL);
+    e->level = level;
+    e->target = target;
+    snprintf(e->text, LOG_MESSAGE_LEN, "%s", text);
+    log_ring().publish(e);
+    return 0;
+}
+
+
 int logger(char* str, int level){
-    static int index = 0;
     int return_val = 0;
-    FILE* fptr;
     if (level<=LOG_LEVEL){
-        timer = time(NULL);
-        tm_info = localtime(&timer);
-        
-        strftime(time_stamp, 26, "%Y-%m-%d %H:%M:%S", tm_info);
-        fptr = fopen(LOGFILE, "a");
-        if (fptr==NULL){
-            printf("File write error\n");
-            return_val = -1;
-        }else{
-            fprintf(fptr, "%d [%s] %s: %s\n", index, time_stamp, levels[level], str);
-            index++;
-            //printf("write file: %s: %s\n", time_stamp, str);
-        }
-        fclose(fptr);
+        return_val = log_push_text(_LOG_MAIN, level, str);
     }
     error_logger(str, level);
     return return_val;
@@ -33,36 +246,37 @@ int logger(char* str, int level){
 
 
 int error_logger(char* str, int level){
-    static int error_index = 0;
     int return_val = 0;
-    FILE* fptr;
     if (level<=2){
-        fptr = fopen(ERROR_LOGFILE, "a");
-        if (fptr==NULL){
-            printf("File write error\n");
-            return_val = -1;
-        }else{
-            fprintf(fptr, "(%d) %s\n", error_index, str);
-            error_index++;
-        }
-        fclose(fptr);
+        return_val = log_push_text(_LOG_ERROR, level, str);
     }
     return return_val;
 }
 
 
 int node_state_data_logger(char* str){
-    static int nsd_index = 0;
+    return log_push_text(_LOG_NODE_STATE, 0, str);
+}
+
+
+int log_printf(int level, const char* format, ...){
     int return_val = 0;
-    FILE* fptr;
-    fptr = fopen(NODE_STATE_DATA_LOGFILE, "a");
-    if (fptr==NULL){
-        printf("File write error\n");
-        return_val = -1;
-    }else{
-        fprintf(fptr, "%s\n",  str);
-        nsd_index++;
+    va_list args;
+    if (level<=LOG_LEVEL){
+        va_start(args, format);
+        return_val = log_push(_LOG_MAIN, level, format, args);
+        va_end(args);
+    }
+    if (level<=2){
+        va_start(args, format);
+        return_val |= log_push(_LOG_ERROR, level, format, args);
+        va_end(args);
     }
-    fclose(fptr);
     return return_val;
-}   
+}
+
+
+// Blocks until everything logged so far is written to disk.
+void logger_flush(){
+    log_ring().flush();
+}
@@ -6,14 +6,28 @@
 #include <stdint.h>
 #include <time.h>
 
+// Messages above LOG_LEVEL are compiled out by LOG(); override with -DLOG_LEVEL=N.
+// 0 CRITICAL, 1 ERROR, 2 WARNING, 3 INFO, 4 DEBUG, 5 per-generation trace.
+#ifndef LOG_LEVEL
 #define LOG_LEVEL 4
+#endif
+
+#define LOG_RING_SIZE 1024          // Messages buffered between flushes; must be a power of two.
+#define LOG_MESSAGE_LEN 240
+#define LOG_FLUSH_MS 50
 
 static const char LOGFILE[]                          = "logs/main_log.txt";
 static const char ERROR_LOGFILE[]                    = "logs/error_log.txt";
 static const char NODE_STATE_DATA_LOGFILE[]          = "logs/node_state_data.txt";
 
+// Formats straight into the log ring; the level test is a constant, so disabled levels
+// leave no code behind, arguments included.
+#define LOG(level, ...) do { if ((level) <= LOG_LEVEL){ log_printf((level), __VA_ARGS__); } } while (0)
+
 int logger(char* str, int level);
 int error_logger(char* str, int level);
 int node_state_data_logger(char* str);
+int log_printf(int level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+void logger_flush();
 
 #endif
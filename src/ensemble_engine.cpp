@@ -0,0 +1,325 @@
+#include "ensemble_engine.h"
+
+#include <algorithm>
+#include "bit_engine.h"
+#include "rng.h"
+#include "simd_engine.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ENSEMBLE_X86 1
+#include <immintrin.h>
+#else
+#define ENSEMBLE_X86 0
+#endif
+
+
+// Kernels fill one row of out. No shifts are needed: the west/east neighbours of a word
+// are the words of the cells to the left and right, wrapping at the row ends.
+static void row_kernel_scalar(const uint64_t* up, const uint64_t* mid, const uint64_t* dn, uint64_t* out, size_t columns, size_t slices,
+                              const uint8_t* counts, size_t count_n, uint16_t birth, uint16_t survive){
+    for (size_t x=0; x<columns; x++){
+        size_t l = ((x == 0) ? columns - 1 : x - 1) * slices;
+        size_t c = x * slices;
+        size_t r = ((x + 1 == columns) ? 0 : x + 1) * slices;
+        for (size_t s=0; s<slices; s++){
+            out[c + s] = life_word(up[l + s], up[c + s], up[r + s], mid[l + s], mid[c + s], mid[r + s],
+                                   dn[l + s], dn[c + s], dn[r + s], counts, count_n, birth, survive);
+        }
+    }
+}
+
+#if ENSEMBLE_X86
+
+__attribute__((target("avx2")))
+static inline __m256i load4(const uint64_t* p){
+    return _mm256_loadu_si256((const __m256i*) p);
+}
+
+__attribute__((target("avx2")))
+static inline void full_add_avx2(__m256i* sum, __m256i* carry, __m256i a, __m256i b, __m256i c){
+    __m256i ab = _mm256_xor_si256(a, b);
+    *sum = _mm256_xor_si256(ab, c);
+    *carry = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, ab));
+}
+
+// life_word() on four slices (256 worlds) at once; a scalar loop takes the slices left over.
+__attribute__((target("avx2")))
+static void row_kernel_avx2(const uint64_t* up, const uint64_t* mid, const uint64_t* dn, uint64_t* out, size_t columns, size_t slices,
+                            const uint8_t* counts, size_t count_n, uint16_t birth, uint16_t survive){
+    __m256i planes[9][4], born_mask[9], kept_mask[9];
+    for (size_t k=0; k<count_n; k++){
+        uint8_t n = counts[k];
+        for (int b=0; b<4; b++){
+            planes[k][b] = _mm256_set1_epi64x(0 - (int64_t)((n >> b) & 1));
+        }
+        born_mask[k] = _mm256_set1_epi64x(0 - (int64_t)((birth >> n) & 1));
+        kept_mask[k] = _mm256_set1_epi64x(0 - (int64_t)((survive >> n) & 1));
+    }
+    for (size_t x=0; x<columns; x++){
+        size_t l = ((x == 0) ? columns - 1 : x - 1) * slices;
+        size_t c = x * slices;
+        size_t r = ((x + 1 == columns) ? 0 : x + 1) * slices;
+        size_t s = 0;
+        for (; s + 4 <= slices; s += 4){
+            __m256i m = load4(mid + c + s);
+            __m256i mw = load4(mid + l + s), me = load4(mid + r + s);
+            __m256i su, cu, sd, cd, s0, c1, ts, tc;
+            full_add_avx2(&su, &cu, load4(up + l + s), load4(up + c + s), load4(up + r + s));
+            full_add_avx2(&sd, &cd, load4(dn + l + s), load4(dn + c + s), load4(dn + r + s));
+            full_add_avx2(&s0, &c1, su, sd, _mm256_xor_si256(mw, me));
+            full_add_avx2(&ts, &tc, cu, cd, _mm256_and_si256(mw, me));
+            __m256i s1 = _mm256_xor_si256(ts, c1);
+            __m256i c2 = _mm256_and_si256(ts, c1);
+            __m256i s2 = _mm256_xor_si256(tc, c2);
+            __m256i s3 = _mm256_and_si256(tc, c2);
+
+            __m256i born = _mm256_setzero_si256(), kept = _mm256_setzero_si256();
+            for (size_t k=0; k<count_n; k++){
+                __m256i diff = _mm256_or_si256(_mm256_or_si256(_mm256_xor_si256(s0, planes[k][0]), _mm256_xor_si256(s1, planes[k][1])),
+                                               _mm256_or_si256(_mm256_xor_si256(s2, planes[k][2]), _mm256_xor_si256(s3, planes[k][3])));
+                born = _mm256_or_si256(born, _mm256_andnot_si256(diff, born_mask[k]));
+                kept = _mm256_or_si256(kept, _mm256_andnot_si256(diff, kept_mask[k]));
+            }
+            _mm256_storeu_si256((__m256i*)(out + c + s), _mm256_or_si256(_mm256_andnot_si256(m, born), _mm256_and_si256(m, kept)));
+        }
+        for (; s<slices; s++){
+            out[c + s] = life_word(up[l + s], up[c + s], up[r + s], mid[l + s], mid[c + s], mid[r + s],
+                                   dn[l + s], dn[c + s], dn[r + s], counts, count_n, birth, survive);
+        }
+    }
+}
+
+#endif
+
+
+EnsembleEngine::EnsembleEngine() :
+        m_columns(0), m_rows(0), m_worlds(0), m_slices(0), m_current(0), m_generation(0)
+    {
+        int isa = _ISA_SCALAR;
+#if ENSEMBLE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")){
+            isa = _ISA_AVX2;
+        }
+#endif
+        set_isa(isa);
+        set_rule(0, 0);
+}
+
+int EnsembleEngine::get_isa(){ return m_isa; }
+const char* EnsembleEngine::get_isa_name(){ return simd_isa_names[m_isa]; }
+
+// There is no SSE2 kernel: the scalar one already moves 64 worlds per operation.
+void EnsembleEngine::set_isa(int isa){
+        m_isa = isa;
+        switch (isa){
+#if ENSEMBLE_X86
+            case _ISA_AVX2:
+                m_row_kernel = &row_kernel_avx2;
+                break;
+#endif
+            default:
+                m_isa = _ISA_SCALAR;
+                m_row_kernel = &row_kernel_scalar;
+                break;
+        }
+}
+
+void EnsembleEngine::set_rule(uint16_t birth, uint16_t survive){
+        m_birth = birth;
+        m_survive = survive;
+        m_count_n = rule_counts(birth, survive, m_counts);
+}
+
+// Empties every world. The last slice may have unused lanes; they start and stay dead
+// unless the rule has B0, and are never reported.
+void EnsembleEngine::resize(size_t columns, size_t rows, size_t worlds){
+        m_columns = columns;
+        m_rows = rows;
+        m_worlds = worlds;
+        m_slices = (worlds + ENSEMBLE_LANES - 1) / ENSEMBLE_LANES;
+        for (std::vector<uint64_t>& buffer : m_buffers){
+            buffer.assign(columns * rows * m_slices, 0);
+        }
+        m_current = 0;
+        m_generation = 0;
+}
+
+size_t EnsembleEngine::get_worlds(){
+        return m_worlds;
+}
+
+uint64_t EnsembleEngine::get_generation(){
+        return m_generation;
+}
+
+// Sets one world from a columns x rows grid; only state 1 counts as live. This restarts
+// the generation count, and with it the history periods() compares against, for all worlds.
+void EnsembleEngine::load(size_t world, const uint8_t* cells){
+        uint64_t* dst = m_buffers[m_current].data() + (world / ENSEMBLE_LANES);
+        const uint64_t bit = (uint64_t)1 << (world % ENSEMBLE_LANES);
+        const size_t n = m_columns * m_rows;
+        for (size_t c=0; c<n; c++){
+            uint64_t& w = dst[c * m_slices];
+            w = (w & ~bit) | (bit & (0 - (uint64_t)(cells[c] == 1)));
+        }
+        m_generation = 0;
+}
+
+void EnsembleEngine::store(size_t world, uint8_t* cells){
+        const uint64_t* src = m_buffers[m_current].data() + (world / ENSEMBLE_LANES);
+        const size_t shift = world % ENSEMBLE_LANES;
+        const size_t n = m_columns * m_rows;
+        for (size_t c=0; c<n; c++){
+            cells[c] = (src[c * m_slices] >> shift) & 1;
+        }
+}
+
+// Fills world w from seeds[w] exactly as World::setup_cells() fills a grid of the same
+// size, so any world can be replayed on its own.
+void EnsembleEngine::fill_random(const uint64_t* seeds, double ld_ratio){
+        std::vector<uint32_t> cutoffs(m_columns, random_cutoff(ld_ratio));
+        std::vector<uint8_t> cells(m_columns * m_rows);
+        for (size_t w=0; w<m_worlds; w++){
+            for (size_t y=0; y<m_rows; y++){
+                random_cells(cells.data() + (y * m_columns), y * m_columns, m_columns, seeds[w], cutoffs.data());
+            }
+            load(w, cells.data());
+        }
+}
+
+// Writes the next generation over the oldest buffer of the ring.
+void EnsembleEngine::step(){
+        const size_t next_ix = (m_current + 1) % (ENSEMBLE_PERIOD_MAX + 1);
+        const uint64_t* cur = m_buffers[m_current].data();
+        uint64_t* next = m_buffers[next_ix].data();
+        const size_t row = m_columns * m_slices;
+        for (size_t y=0; y<m_rows; y++){
+            const uint64_t* up = cur + (((y + m_rows - 1) % m_rows) * row);
+            const uint64_t* dn = cur + (((y + 1) % m_rows) * row);
+            (*m_row_kernel)(up, cur + (y * row), dn, next + (y * row), m_columns, m_slices, m_counts, m_count_n, m_birth, m_survive);
+        }
+        m_current = next_ix;
+        m_generation++;
+}
+
+// Live cells per world. Every slice keeps a binary counter per lane as bit-planes
+// (planes[p] is weight 2^p); sixteen cells at a time go through a carry-save adder tree
+// into planes 0..3 and only the weight-16 carry ripples further, so the tree does most of
+// the work without branches. The lanes are read off the planes at the end.
+void EnsembleEngine::count(uint32_t* populations){
+        const uint64_t* cells = m_buffers[m_current].data();
+        const size_t n = m_columns * m_rows;
+        const size_t S = m_slices;
+        size_t plane_n = 1;
+        while (((size_t)1 << plane_n) <= n){
+            plane_n++;
+        }
+        m_planes.assign(std::max<size_t>(plane_n, 5) * S, 0);
+        uint64_t* planes = m_planes.data();
+
+        size_t c = 0;
+        for (; c + 16 <= n; c += 16){
+            const uint64_t* w = cells + (c * S);
+            for (size_t s=0; s<S; s++){
+                uint64_t ones = planes[s], twos = planes[S + s], fours = planes[2 * S + s], eights = planes[3 * S + s];
+                uint64_t twos_a, twos_b, fours_a, fours_b, eights_a, eights_b, sixteens;
+                full_add(&ones, &twos_a, ones, w[s], w[S + s]);
+                full_add(&ones, &twos_b, ones, w[2 * S + s], w[3 * S + s]);
+                full_add(&twos, &fours_a, twos, twos_a, twos_b);
+                full_add(&ones, &twos_a, ones, w[4 * S + s], w[5 * S + s]);
+                full_add(&ones, &twos_b, ones, w[6 * S + s], w[7 * S + s]);
+                full_add(&twos, &fours_b, twos, twos_a, twos_b);
+                full_add(&fours, &eights_a, fours, fours_a, fours_b);
+                full_add(&ones, &twos_a, ones, w[8 * S + s], w[9 * S + s]);
+                full_add(&ones, &twos_b, ones, w[10 * S + s], w[11 * S + s]);
+                full_add(&twos, &fours_a, twos, twos_a, twos_b);
+                full_add(&ones, &twos_a, ones, w[12 * S + s], w[13 * S + s]);
+                full_add(&ones, &twos_b, ones, w[14 * S + s], w[15 * S + s]);
+                full_add(&twos, &fours_b, twos, twos_a, twos_b);
+                full_add(&fours, &eights_b, fours, fours_a, fours_b);
+                full_add(&eights, &sixteens, eights, eights_a, eights_b);
+                planes[s] = ones;
+                planes[S + s] = twos;
+                planes[2 * S + s] = fours;
+                planes[3 * S + s] = eights;
+                for (size_t p=4; sixteens; p++){
+                    uint64_t carry = planes[p * S + s] & sixteens;
+                    planes[p * S + s] ^= sixteens;
+                    sixteens = carry;
+                }
+            }
+        }
+        for (; c<n; c++){
+            for (size_t s=0; s<S; s++){
+                uint64_t add = cells[c * S + s];
+                for (size_t p=0; add; p++){
+                    uint64_t carry = planes[p * S + s] & add;
+                    planes[p * S + s] ^= add;
+                    add = carry;
+                }
+            }
+        }
+
+        for (size_t w=0; w<m_worlds; w++){
+            const uint64_t* lane = planes + (w / ENSEMBLE_LANES);
+            const size_t shift = w % ENSEMBLE_LANES;
+            uint32_t population = 0;
+            for (size_t p=0; p<plane_n; p++){
+                population |= (uint32_t)((lane[p * S] >> shift) & 1) << p;
+            }
+            populations[w] = population;
+        }
+}
+
+// Sets periods[w] to the shortest period p <= ENSEMBLE_PERIOD_MAX for which world w is the
+// same as p generations ago, or 0. Only generations since the last load count. All kept
+// generations are compared in one pass, row by row, which stops early once every world
+// differs from every one of them, as still-chaotic worlds soon do.
+void EnsembleEngine::periods(uint8_t* periods){
+        const uint64_t* cur = m_buffers[m_current].data();
+        const size_t S = m_slices;
+        const size_t row = m_columns * S;
+        const size_t period_n = std::min<uint64_t>(m_generation, ENSEMBLE_PERIOD_MAX);
+        const uint64_t* old[ENSEMBLE_PERIOD_MAX];
+        for (size_t p=1; p<=period_n; p++){
+            old[p - 1] = m_buffers[(m_current + ENSEMBLE_PERIOD_MAX + 1 - p) % (ENSEMBLE_PERIOD_MAX + 1)].data();
+        }
+        // Unused lanes of the last slice never count as unchanged.
+        const uint64_t tail = (m_worlds % ENSEMBLE_LANES) ? ~(((uint64_t)1 << (m_worlds % ENSEMBLE_LANES)) - 1) : 0;
+        m_changed.assign(period_n * S, 0);
+        for (size_t p=0; p<period_n; p++){
+            m_changed[(p * S) + S - 1] = tail;
+        }
+
+        for (size_t y=0; y<m_rows && period_n; y++){
+            uint64_t all = ~(uint64_t)0;
+            for (size_t p=0; p<period_n; p++){
+                uint64_t* changed = m_changed.data() + (p * S);
+                const uint64_t* a = cur + (y * row);
+                const uint64_t* b = old[p] + (y * row);
+                for (size_t x=0; x<m_columns; x++){
+                    for (size_t s=0; s<S; s++){
+                        changed[s] |= a[x * S + s] ^ b[x * S + s];
+                    }
+                }
+                for (size_t s=0; s<S; s++){
+                    all &= changed[s];
+                }
+            }
+            if (all == ~(uint64_t)0){
+                break;
+            }
+        }
+
+        std::fill(periods, periods + m_worlds, 0);
+        // Longest first, so a world that repeats at several periods keeps the shortest.
+        for (size_t p=period_n; p>0; p--){
+            const uint64_t* changed = m_changed.data() + ((p - 1) * S);
+            for (size_t w=0; w<m_worlds; w++){
+                if (!((changed[w / ENSEMBLE_LANES] >> (w % ENSEMBLE_LANES)) & 1)){
+                    periods[w] = p;
+                }
+            }
+        }
+}
@@ -0,0 +1,166 @@
+#include "frame_capture.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "c_logger.h"
+
+
+FrameCapture::FrameCapture() :
+        m_head(0), m_count(0), m_running(false), m_blocking(false),
+        m_frame_index(0), m_written(0), m_dropped(0), m_waits(0)
+    {
+        set_dir(CAPTURE_DIR);
+}
+
+FrameCapture::~FrameCapture(){
+        stop();
+}
+
+void FrameCapture::set_dir(const char* dir){
+        snprintf(m_dir, CAPTURE_DIR_LEN, "%s", dir);
+        size_t n = strlen(m_dir);
+        if (n > 0 && n < CAPTURE_DIR_LEN - 1 && m_dir[n - 1] != '/'){
+            m_dir[n] = '/';
+            m_dir[n + 1] = '\0';
+        }
+}
+
+void FrameCapture::set_blocking(bool blocking){
+        m_blocking = blocking;
+}
+
+bool FrameCapture::start(){
+        if (m_running){
+            return true;
+        }
+        if (mkdir(m_dir, 0755) != 0 && errno != EEXIST){
+            LOG(2, "%s: cannot create '%s'.", __func__, m_dir);
+            return false;
+        }
+        m_running = true;
+        m_writer = std::thread(&FrameCapture::writer_loop, this);
+        LOG(4, "%s: recording to '%s'.", __func__, m_dir);
+        return true;
+}
+
+// Lets the writer drain every queued frame before it exits; a push() waiting for a slot gives up.
+void FrameCapture::stop(){
+        if (!m_running){
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_ready_cv.notify_all();
+        m_free_cv.notify_all();
+        m_writer.join();
+        LOG(4, "%s: written: %ld, dropped: %ld, waits: %ld.", __func__, m_written, m_dropped, m_waits);
+}
+
+void FrameCapture::toggle(){
+        if (m_running){
+            stop();
+        }else{
+            start();
+        }
+}
+
+bool FrameCapture::is_running(){
+        return m_running;
+}
+
+// fill copies one generation into the free slot it is given. The slot at m_head belongs
+// to the caller until m_count is raised, so the copy happens outside the lock and the
+// writer only ever touches the oldest queued slots. A full ring is checked first, so a
+// dropped generation costs no copy.
+bool FrameCapture::push(const std::function<void(capture_frame& frame)>& fill){
+        if (!m_running){
+            return false;
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_count == CAPTURE_SLOTS){
+                if (!m_blocking){
+                    m_dropped++;
+                    return false;
+                }
+                m_waits++;
+                m_free_cv.wait(lock, [&]{ return m_count < CAPTURE_SLOTS || !m_running; });
+            }
+            if (!m_running){
+                return false;
+            }
+        }
+        fill(m_slots[m_head]);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_head = (m_head + 1) % CAPTURE_SLOTS;
+            m_count++;
+        }
+        m_ready_cv.notify_one();
+        return true;
+}
+
+void FrameCapture::writer_loop(){
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true){
+            m_ready_cv.wait(lock, [&]{ return m_count > 0 || !m_running; });
+            if (m_count == 0){
+                break;
+            }
+            size_t tail = (m_head + CAPTURE_SLOTS - m_count) % CAPTURE_SLOTS;
+            size_t index = m_frame_index++;
+            lock.unlock();
+            write_frame(&m_slots[tail], index);
+            lock.lock();
+            m_count--;
+            m_written++;
+            m_free_cv.notify_one();
+        }
+}
+
+// Colours the cells as draw_cells() does at one pixel per cell, with dead cells opaque black.
+void FrameCapture::write_frame(capture_frame* frame, size_t index){
+        size_t count = frame->columns * frame->rows;
+        const uint8_t* cells = frame->cells.data();
+        const uint32_t* births = frame->births.empty() ? nullptr : frame->births.data();
+        frame->pixels.resize(count);
+        for (size_t c=0; c<count; c++){
+            if (frame->states > 2 && cells[c]){
+                frame->pixels[c] = m_colours.state_colour(cells[c], frame->states);
+            }else if (cells[c]){
+                frame->pixels[c] = m_colours.age_colour(births ? (frame->birth_now - births[c]) + 1 : 1);
+            }else{
+                frame->pixels[c] = {0, 0, 0, 255};
+            }
+        }
+        char file_name[CAPTURE_DIR_LEN + 64];
+        snprintf(file_name, sizeof(file_name), "%sframe_%06ld_gen_%ld.png", m_dir, index, frame->generation);
+        Image image = {frame->pixels.data(), (int)frame->columns, (int)frame->rows, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+        if (!ExportImage(image, file_name)){
+            LOG(2, "%s: failed to write '%s'.", __func__, file_name);
+        }
+}
+
+size_t FrameCapture::get_pending(){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count;
+}
+
+size_t FrameCapture::get_written(){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_written;
+}
+
+size_t FrameCapture::get_dropped(){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_dropped;
+}
+
+size_t FrameCapture::get_waits(){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_waits;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <raylib.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "renderer.h"
+
+#define CAPTURE_SLOTS 16
+#define CAPTURE_DIR_LEN 256
+#define CAPTURE_DIR "screenshots/"
+
+
+struct capture_frame{
+    std::vector<uint8_t> cells;
+    std::vector<uint32_t> births;   // Empty when ages are disabled.
+    uint32_t birth_now;
+    uint16_t states;
+    size_t columns;
+    size_t rows;
+    uint64_t generation;
+    std::vector<Color> pixels;      // Coloured by the writer.
+};
+
+
+// Records every generation without slowing the simulation: push() is called on the
+// simulation thread after each step and copies the raw cells and birth stamps (one pixel
+// per cell, whatever the camera shows) into a bounded ring. A writer thread colours and
+// encodes the PNGs. When the writer falls behind, the ring fills and push() either drops
+// the generation or, with blocking on, waits for a free slot. Both are counted so a
+// recording can be checked.
+class FrameCapture{
+    private:
+        capture_frame m_slots[CAPTURE_SLOTS];
+        size_t m_head;              // Next slot to fill.
+        size_t m_count;             // Slots waiting for the writer.
+        std::mutex m_mutex;
+        std::condition_variable m_ready_cv;
+        std::condition_variable m_free_cv;
+        std::thread m_writer;
+        std::atomic<bool> m_running;    // Read by push() on the simulation thread.
+        bool m_blocking;
+        char m_dir[CAPTURE_DIR_LEN];
+        size_t m_frame_index;
+        size_t m_written;
+        size_t m_dropped;
+        size_t m_waits;
+        CellRenderer m_colours;         // Only its colour lookups, on the writer thread.
+
+        void writer_loop();
+        void write_frame(capture_frame* frame, size_t index);
+
+    public:
+        FrameCapture();
+        ~FrameCapture();
+        void set_dir(const char* dir);
+        void set_blocking(bool blocking);
+        bool start();
+        void stop();
+        void toggle();
+        bool is_running();
+        bool push(const std::function<void(capture_frame& frame)>& fill);
+        size_t get_pending();
+        size_t get_written();
+        size_t get_dropped();
+        size_t get_waits();
+};
@@ -0,0 +1,80 @@
+#include "generations_engine.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GENERATIONS_SSE2 1
+#include <emmintrin.h>
+#else
+#define GENERATIONS_SSE2 0
+#endif
+
+
+static inline uint8_t live_count(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, size_t xl, size_t x, size_t xr){
+    return (up[xl] == 1) + (up[x] == 1) + (up[xr] == 1) + (mid[xl] == 1) + (mid[xr] == 1)
+         + (dn[xl] == 1) + (dn[x] == 1) + (dn[xr] == 1);
+}
+
+
+GenerationsEngine::GenerationsEngine(){
+        rule_t rule = {};
+        rule.states = 2;
+        set_rule(rule);
+}
+
+void GenerationsEngine::set_rule(const rule_t& rule){
+        const uint8_t dying = (rule.states > 2) ? 2 : 0;
+        m_table.assign(rule.states * 9, 0);
+        for (int n=0; n<9; n++){
+            m_table[n]     = (rule.birth >> n) & 1;
+            m_table[9 + n] = ((rule.survive >> n) & 1) ? 1 : dying;
+            for (int s=2; s<rule.states; s++){
+                m_table[(s * 9) + n] = (s + 1 < rule.states) ? s + 1 : 0;
+            }
+        }
+}
+
+// Counts a batch of cells first and looks their states up after, so the counting loop has
+// no table access and the interior of a row needs no wrap-around test.
+void GenerationsEngine::step_span(const uint8_t* cells, uint8_t* next, size_t columns, size_t rows, size_t y, size_t x0, size_t x1){
+        const uint8_t* up  = cells + (((y + rows - 1) % rows) * columns);
+        const uint8_t* mid = cells + (y * columns);
+        const uint8_t* dn  = cells + (((y + 1) % rows) * columns);
+        uint8_t* out = next + (y * columns);
+        const uint8_t* table = m_table.data();
+        uint8_t counts[GENERATIONS_SPAN];
+        for (size_t s=x0; s<x1; s+=GENERATIONS_SPAN){
+            size_t e = std::min(s + GENERATIONS_SPAN, x1);
+            size_t x = s;
+            if (x == 0){
+                counts[0] = live_count(up, mid, dn, columns - 1, 0, 1 % columns);
+                x = 1;
+            }
+            size_t inner = std::min(e, columns - 1);
+#if GENERATIONS_SSE2
+            // Each neighbour compares to 0xFF where it is live; the negated sum is the count.
+            const __m128i one = _mm_set1_epi8(1);
+            for (; x + 16 <= inner; x += 16){
+                __m128i sum = _mm_setzero_si128();
+                const uint8_t* rows3[3] = {up, mid, dn};
+                for (int r=0; r<3; r++){
+                    sum = _mm_add_epi8(sum, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(rows3[r] + x - 1)), one));
+                    sum = _mm_add_epi8(sum, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(rows3[r] + x + 1)), one));
+                    if (r != 1){
+                        sum = _mm_add_epi8(sum, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(rows3[r] + x)), one));
+                    }
+                }
+                _mm_storeu_si128((__m128i*)(counts + x - s), _mm_sub_epi8(_mm_setzero_si128(), sum));
+            }
+#endif
+            for (; x<inner; x++){
+                counts[x - s] = live_count(up, mid, dn, x - 1, x, x + 1);
+            }
+            for (; x<e; x++){
+                counts[x - s] = live_count(up, mid, dn, x - 1, x, (x + 1) % columns);
+            }
+            for (x=s; x<e; x++){
+                out[x] = table[(mid[x] * 9) + counts[x - s]];
+            }
+        }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "rules.h"
+
+#define GENERATIONS_SPAN 64     // Cells counted per batch before their table lookups.
+
+
+// Generations engine: state 0 is dead, 1 alive, and 2..C-1 are dying. Only live cells count
+// as neighbours. A dying cell moves one state on per generation, blocks births, and ends
+// at 0. The next state is one lookup in a C * 9 table indexed by state and neighbour count,
+// so every state takes the same path through the loop.
+class GenerationsEngine{
+    private:
+        std::vector<uint8_t> m_table;
+
+    public:
+        GenerationsEngine();
+        void set_rule(const rule_t& rule);
+        void step_span(const uint8_t* cells, uint8_t* next, size_t columns, size_t rows, size_t y, size_t x0, size_t x1);
+};
@@ -0,0 +1,331 @@
+#include "hashlife.h"
+
+#include <stdint.h>
+#include <string.h>
+
+
+HashLife::HashLife() :
+        m_root(0), m_origin_x(0), m_origin_y(0), m_birth(0), m_survive(0),
+        m_node_limit(HASHLIFE_NODE_LIMIT), m_abort_at(SIZE_MAX), m_aborted(false)
+    {
+        reset();
+}
+
+// Drops every node except the two leaves (0 = dead, 1 = alive).
+void HashLife::reset(){
+        m_nodes.clear();
+        m_hash.clear();
+        m_empty.clear();
+        m_nodes.push_back({0, 0, 0, 0, 0, -1, 0, 0});
+        m_nodes.push_back({0, 0, 0, 0, 0, -1, 0, 1});
+        m_empty.push_back(0);
+        m_root = 0;
+        m_origin_x = 0;
+        m_origin_y = 0;
+}
+
+void HashLife::set_node_limit(size_t nodes){
+        m_node_limit = nodes;
+}
+
+// Rules with B0 turn empty space on, which the quadtree cannot represent.
+bool HashLife::set_rule(uint16_t birth, uint16_t survive){
+        if (birth & 1){
+            return false;
+        }
+        if (birth != m_birth || survive != m_survive){
+            m_birth = birth;
+            m_survive = survive;
+            reset();
+        }
+        return true;
+}
+
+size_t HashLife::get_node_count(){
+        return m_nodes.size();
+}
+
+uint64_t HashLife::get_population(){
+        return m_nodes[m_root].population;
+}
+
+uint32_t HashLife::join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se){
+        hl_key key = {nw, ne, sw, se};
+        auto it = m_hash.find(key);
+        if (it != m_hash.end()){
+            return it->second;
+        }
+        hl_node node;
+        node.nw = nw;
+        node.ne = ne;
+        node.sw = sw;
+        node.se = se;
+        node.result = 0;
+        node.result_step = -1;
+        node.level = m_nodes[nw].level + 1;
+        node.population = m_nodes[nw].population + m_nodes[ne].population + m_nodes[sw].population + m_nodes[se].population;
+        uint32_t index = m_nodes.size();
+        m_nodes.push_back(node);
+        m_hash.emplace(key, index);
+        m_aborted |= m_nodes.size() > m_abort_at;
+        return index;
+}
+
+uint32_t HashLife::empty(uint8_t level){
+        while (m_empty.size() <= level){
+            uint32_t e = m_empty.back();
+            m_empty.push_back(join(e, e, e, e));
+        }
+        return m_empty[level];
+}
+
+uint32_t HashLife::centre(uint32_t n){
+        hl_node c = m_nodes[n];
+        return join(m_nodes[c.nw].se, m_nodes[c.ne].sw, m_nodes[c.sw].ne, m_nodes[c.se].nw);
+}
+
+// Wraps n in an empty border: the result is one level up with n in its centre.
+uint32_t HashLife::expand(uint32_t n){
+        hl_node c = m_nodes[n];
+        uint32_t e = empty(c.level - 1);
+        return join(join(e, e, e, c.nw), join(e, e, c.ne, e), join(e, c.sw, e, e), join(c.se, e, e, e));
+}
+
+// Level-2 node (4x4 cells): returns its centre 2x2 one generation later.
+uint32_t HashLife::base_step(uint32_t n){
+        hl_node c = m_nodes[n];
+        uint32_t quads[4] = {c.nw, c.ne, c.sw, c.se};
+        uint8_t bits[4][4];
+        for (int q=0; q<4; q++){
+            hl_node s = m_nodes[quads[q]];
+            int x0 = (q & 1) * 2;
+            int y0 = (q >> 1) * 2;
+            bits[y0][x0]         = m_nodes[s.nw].population;
+            bits[y0][x0 + 1]     = m_nodes[s.ne].population;
+            bits[y0 + 1][x0]     = m_nodes[s.sw].population;
+            bits[y0 + 1][x0 + 1] = m_nodes[s.se].population;
+        }
+        uint32_t out[4];
+        for (int i=0; i<4; i++){
+            int x = 1 + (i & 1);
+            int y = 1 + (i >> 1);
+            int count = 0;
+            for (int dy=-1; dy<=1; dy++){
+                for (int dx=-1; dx<=1; dx++){
+                    count += (dx || dy) ? bits[y + dy][x + dx] : 0;
+                }
+            }
+            uint16_t mask = bits[y][x] ? m_survive : m_birth;
+            out[i] = (mask >> count) & 1;
+        }
+        return join(out[0], out[1], out[2], out[3]);
+}
+
+// Returns the centre of level-k node n advanced by 2^j generations (j <= k-2), as a
+// level k-1 node. Nine overlapping sub-squares are reduced to four, then to one; the
+// first reduction only advances time when j is the full 2^(k-2) step. Once the cache
+// outgrows m_abort_at the recursion unwinds without memoising anything, and the
+// result is meaningless.
+uint32_t HashLife::successor(uint32_t n, int j){
+        if (m_aborted){
+            return 0;
+        }
+        hl_node c = m_nodes[n];
+        if (c.population == 0){
+            return empty(c.level - 1);
+        }
+        if (c.result_step == j){
+            return c.result;
+        }
+        uint32_t r;
+        if (c.level == 2){
+            r = base_step(n);
+        }else{
+            hl_node nw = m_nodes[c.nw], ne = m_nodes[c.ne], sw = m_nodes[c.sw], se = m_nodes[c.se];
+            uint32_t sub[9] = {
+                c.nw,
+                join(nw.ne, ne.nw, nw.se, ne.sw),
+                c.ne,
+                join(nw.sw, nw.se, sw.nw, sw.ne),
+                join(nw.se, ne.sw, sw.ne, se.nw),
+                join(ne.sw, ne.se, se.nw, se.ne),
+                c.sw,
+                join(sw.ne, se.nw, sw.se, se.sw),
+                c.se};
+            bool full = (j == c.level - 2);
+            for (int i=0; i<9; i++){
+                sub[i] = full ? successor(sub[i], c.level - 3) : centre(sub[i]);
+            }
+            if (m_aborted){
+                return 0;
+            }
+            int step = (j < c.level - 3) ? j : c.level - 3;
+            uint32_t q0 = successor(join(sub[0], sub[1], sub[3], sub[4]), step);
+            uint32_t q1 = successor(join(sub[1], sub[2], sub[4], sub[5]), step);
+            uint32_t q2 = successor(join(sub[3], sub[4], sub[6], sub[7]), step);
+            uint32_t q3 = successor(join(sub[4], sub[5], sub[7], sub[8]), step);
+            if (m_aborted){
+                return 0;
+            }
+            r = join(q0, q1, q2, q3);
+        }
+        m_nodes[n].result = r;
+        m_nodes[n].result_step = j;
+        return r;
+}
+
+uint32_t HashLife::build(const uint8_t* cells, size_t columns, size_t rows, uint8_t level, int64_t x, int64_t y){
+        if (x >= (int64_t)columns || y >= (int64_t)rows){
+            return empty(level);
+        }
+        if (level == 0){
+            return cells[(y * columns) + x] ? 1 : 0;
+        }
+        int64_t half = (int64_t)1 << (level - 1);
+        return join(build(cells, columns, rows, level - 1, x, y),
+                    build(cells, columns, rows, level - 1, x + half, y),
+                    build(cells, columns, rows, level - 1, x, y + half),
+                    build(cells, columns, rows, level - 1, x + half, y + half));
+}
+
+void HashLife::load(const uint8_t* cells, size_t columns, size_t rows){
+        reset();
+        uint8_t level = 2;
+        while (((size_t)1 << level) < columns || ((size_t)1 << level) < rows){
+            level++;
+        }
+        m_root = build(cells, columns, rows, level, 0, 0);
+}
+
+// Advances 2^log2_steps generations within the node limit. The jump is tried whole; if
+// it would outgrow the cache it is abandoned, the cache collected, and the jump done as
+// twice as many jumps half the size, as often as needed. Collections also run between the
+// smaller jumps, so the cache never holds much more than the limit while a jump runs. A
+// universe that fills half the cache on its own leaves no room to step in, so then, or
+// when even a single generation does not fit, the rest of the jump runs uncapped.
+void HashLife::advance(int log2_steps){
+        int j = log2_steps;
+        uint64_t left = 1;      // Jumps of 2^j still to do.
+        bool capped = true;
+        while (left){
+            if (jump(j, capped)){
+                left--;
+                if (m_nodes.size() > m_node_limit){
+                    collect();
+                }
+                continue;
+            }
+            collect();
+            if (j == 0 || m_nodes.size() > m_node_limit / 2){
+                capped = false;
+            }else{
+                j--;
+                left *= 2;
+            }
+        }
+}
+
+// One jump of 2^j generations. With capped set it gives up once the cache passes the node
+// limit, leaving the universe as it was, and returns false.
+bool HashLife::jump(int j, bool capped){
+        const uint32_t old_root = m_root;
+        const int64_t old_x = m_origin_x, old_y = m_origin_y;
+        while (m_nodes[m_root].level < j + 2 || m_nodes[centre(m_root)].population != m_nodes[m_root].population){
+            int64_t quarter = (int64_t)1 << (m_nodes[m_root].level - 1);
+            m_root = expand(m_root);
+            m_origin_x -= quarter;
+            m_origin_y -= quarter;
+        }
+        int64_t quarter = (int64_t)1 << (m_nodes[m_root].level - 1);
+        m_root = expand(m_root);
+        m_origin_x -= quarter;
+        m_origin_y -= quarter;
+
+        m_abort_at = capped ? m_node_limit : SIZE_MAX;
+        m_aborted = false;
+        uint32_t root = successor(m_root, j);
+        m_abort_at = SIZE_MAX;
+        if (m_aborted){
+            m_aborted = false;
+            m_root = old_root;
+            m_origin_x = old_x;
+            m_origin_y = old_y;
+            return false;
+        }
+        int64_t shift = (int64_t)1 << (m_nodes[m_root].level - 2);
+        m_root = root;
+        m_origin_x += shift;
+        m_origin_y += shift;
+        return true;
+}
+
+// Mark-compact garbage collection: keeps only nodes reachable from the root and drops all
+// memoised results, which bounds memory over long runs at the cost of recomputation.
+void HashLife::collect(){
+        std::vector<uint32_t> remap(m_nodes.size(), UINT32_MAX);
+        std::vector<uint32_t> stack;
+        std::vector<hl_node> kept;
+        remap[0] = 0;
+        remap[1] = 1;
+        kept.push_back(m_nodes[0]);
+        kept.push_back(m_nodes[1]);
+
+        // Children are always older than their parent, so visiting reachable nodes in
+        // index order lets every child be remapped before it is referenced.
+        std::vector<uint8_t> reachable(m_nodes.size(), 0);
+        stack.push_back(m_root);
+        while (!stack.empty()){
+            uint32_t n = stack.back();
+            stack.pop_back();
+            if (n < 2 || reachable[n]){
+                continue;
+            }
+            reachable[n] = 1;
+            stack.push_back(m_nodes[n].nw);
+            stack.push_back(m_nodes[n].ne);
+            stack.push_back(m_nodes[n].sw);
+            stack.push_back(m_nodes[n].se);
+        }
+        m_hash.clear();
+        for (size_t n=2; n<m_nodes.size(); n++){
+            if (!reachable[n]){
+                continue;
+            }
+            hl_node node = m_nodes[n];
+            node.nw = remap[node.nw];
+            node.ne = remap[node.ne];
+            node.sw = remap[node.sw];
+            node.se = remap[node.se];
+            node.result = 0;
+            node.result_step = -1;
+            remap[n] = kept.size();
+            m_hash.emplace(hl_key{node.nw, node.ne, node.sw, node.se}, remap[n]);
+            kept.push_back(node);
+        }
+        m_nodes.swap(kept);
+        m_root = remap[m_root];
+        m_empty.clear();
+        m_empty.push_back(0);
+}
+
+void HashLife::write(uint32_t n, uint8_t* cells, size_t columns, size_t rows, int64_t x, int64_t y){
+        const hl_node& c = m_nodes[n];
+        int64_t size = (int64_t)1 << c.level;
+        if (c.population == 0 || x >= (int64_t)columns || y >= (int64_t)rows || x + size <= 0 || y + size <= 0){
+            return;
+        }
+        if (c.level == 0){
+            cells[(y * columns) + x] = 1;
+            return;
+        }
+        int64_t half = size / 2;
+        write(c.nw, cells, columns, rows, x, y);
+        write(c.ne, cells, columns, rows, x + half, y);
+        write(c.sw, cells, columns, rows, x, y + half);
+        write(c.se, cells, columns, rows, x + half, y + half);
+}
+
+void HashLife::store(uint8_t* cells, size_t columns, size_t rows){
+        memset(cells, 0, columns * rows);
+        write(m_root, cells, columns, rows, m_origin_x, m_origin_y);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#define HASHLIFE_NODE_LIMIT (1 << 21)
+
+
+struct hl_node{
+    uint32_t nw, ne, sw, se;
+    uint32_t result;
+    int8_t result_step;     // log2 of the generations memoised in result, -1 if none.
+    uint8_t level;          // Node covers 2^level x 2^level cells; leaves are level 0.
+    uint64_t population;
+};
+
+struct hl_key{
+    uint32_t nw, ne, sw, se;
+    bool operator==(const hl_key& other) const {
+        return nw == other.nw && ne == other.ne && sw == other.sw && se == other.se;
+    }
+};
+
+struct hl_key_hash{
+    size_t operator()(const hl_key& k) const {
+        uint64_t h = ((uint64_t)k.nw * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)k.ne * 0xC2B2AE3D27D4EB4FULL)
+                   ^ ((uint64_t)k.sw * 0x165667B19E3779F9ULL) ^ ((uint64_t)k.se * 0x27D4EB2F165667C5ULL);
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+
+// HashLife engine: the universe is a hash-consed quadtree and every node memoises its
+// centre advanced by 2^j generations, so regular patterns can jump millions of generations.
+// The universe is an unbounded plane; the World grid is a window onto it at (0, 0).
+class HashLife{
+    private:
+        std::vector<hl_node> m_nodes;
+        std::unordered_map<hl_key, uint32_t, hl_key_hash> m_hash;
+        std::vector<uint32_t> m_empty;
+        uint32_t m_root;
+        int64_t m_origin_x;
+        int64_t m_origin_y;
+        uint16_t m_birth;
+        uint16_t m_survive;
+        size_t m_node_limit;
+        size_t m_abort_at;      // Node count at which a running jump gives up; SIZE_MAX when uncapped.
+        bool m_aborted;
+
+        uint32_t join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+        uint32_t empty(uint8_t level);
+        uint32_t centre(uint32_t n);
+        uint32_t expand(uint32_t n);
+        uint32_t base_step(uint32_t n);
+        uint32_t successor(uint32_t n, int j);
+        bool jump(int j, bool capped);
+        uint32_t build(const uint8_t* cells, size_t columns, size_t rows, uint8_t level, int64_t x, int64_t y);
+        void write(uint32_t n, uint8_t* cells, size_t columns, size_t rows, int64_t x, int64_t y);
+        void reset();
+        void collect();
+
+    public:
+        HashLife();
+        void set_node_limit(size_t nodes);
+        bool set_rule(uint16_t birth, uint16_t survive);
+        void load(const uint8_t* cells, size_t columns, size_t rows);
+        void advance(int log2_steps);
+        void store(uint8_t* cells, size_t columns, size_t rows);
+        size_t get_node_count();
+        uint64_t get_population();
+};
@@ -0,0 +1,118 @@
+#include "lod_pyramid.h"
+
+#include <algorithm>
+#include <vector>
+#include "state_file.h"
+
+
+// Live cells in each 2^level bit field of v, for level 1..3, one count per field.
+static inline uint64_t field_counts(uint64_t v, size_t level){
+    v -= (v >> 1) & 0x5555555555555555ULL;
+    if (level > 1){
+        v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    }
+    if (level > 2){
+        v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    }
+    return v;
+}
+
+// Computes the window in bands of output rows on pool. row(y, scratch) gives packed row y
+// from the word holding the window's first cell on, with no live bits past the grid.
+// Levels 1 and 2 add up their 2- or 4-bit fields a row at a time; from level 3 on, the
+// byte counts of each word are summed down the block's rows in 16-bit lanes and only
+// then added into the blocks. The counts are scaled rounding up. Cells past the edge of
+// the grid count as dead, as if the grid were padded to whole blocks.
+template <typename packed_row>
+static void density_bands(size_t columns, size_t rows, const lod_window& window, uint8_t* out, ThreadPool& pool, packed_row row){
+    const uint64_t lo = 0x00FF00FF00FF00FFULL;
+    const size_t level = window.level;
+    const size_t blocks = window.x1 - window.x0;
+    const size_t out_rows = window.y1 - window.y0;
+    const size_t w0 = (window.x0 << level) / 64;
+    const size_t words = ((std::min(columns, window.x1 << level) + 63) / 64) - w0;
+    const size_t field = std::min<size_t>(level, 3);
+    const uint32_t area = 1U << (2 * level);
+    size_t bands = (out_rows + LOD_BAND_ROWS - 1) / LOD_BAND_ROWS;
+    pool.run(bands, [&](size_t band){
+        std::vector<uint32_t> counts(blocks);
+        std::vector<uint64_t> even(words), odd(words), scratch;
+        // Adds a count for the field at bit x of word j to its block, if the window has it.
+        auto add = [&](size_t j, size_t x, uint64_t count){
+            size_t b = (((w0 + j) * 64) + x) >> level;
+            if (count && b >= window.x0 && b < window.x1){
+                counts[b - window.x0] += count;
+            }
+        };
+        size_t b1 = std::min(out_rows, (band + 1) * LOD_BAND_ROWS);
+        for (size_t b=band * LOD_BAND_ROWS; b<b1; b++){
+            std::fill(counts.begin(), counts.end(), 0);
+            std::fill(even.begin(), even.end(), 0);
+            std::fill(odd.begin(), odd.end(), 0);
+            size_t y0 = (window.y0 + b) << level;
+            size_t y1 = std::min(rows, y0 + ((size_t)1 << level));
+            for (size_t y=y0; y<y1; y++){
+                const uint64_t* r = row(y, w0, words, scratch);
+                for (size_t j=0; j<words; j++){
+                    if (!r[j]){
+                        continue;
+                    }
+                    uint64_t c = field_counts(r[j], field);
+                    if (level < 3){
+                        size_t width = (size_t)1 << level;
+                        for (size_t x=0; x<64; x+=width){
+                            add(j, x, (c >> x) & ((1ULL << width) - 1));
+                        }
+                    }else{
+                        even[j] += c & lo;
+                        odd[j] += (c >> 8) & lo;
+                    }
+                }
+            }
+            for (size_t j=0; level >= 3 && j<words; j++){
+                for (size_t k=0; (even[j] | odd[j]) && k<4; k++){
+                    add(j, 16 * k, (even[j] >> (16 * k)) & 0xFFFF);
+                    add(j, (16 * k) + 8, (odd[j] >> (16 * k)) & 0xFFFF);
+                }
+            }
+            uint8_t* dst = out + (b * blocks);
+            for (size_t x=0; x<blocks; x++){
+                dst[x] = ((counts[x] * 255) + area - 1) >> (2 * level);
+            }
+        }
+    });
+}
+
+
+// Enough levels that the coarsest one fits the field; 0 when the grid already does.
+size_t lod_levels(size_t columns, size_t rows, size_t field_w, size_t field_h){
+        size_t levels = 0;
+        while (levels < LOD_LEVELS_MAX && (lod_blocks(columns, levels) > field_w || lod_blocks(rows, levels) > field_h)){
+            levels++;
+        }
+        return levels;
+}
+
+// Blocks of a level across a side of cells, the last one possibly partial.
+size_t lod_blocks(size_t cells, size_t level){
+        return ((cells - 1) >> level) + 1;
+}
+
+// The window of level window.level from the byte grid. Each row span under the window is
+// packed into bits first, so both sources share the counting.
+void lod_density(const uint8_t* cells, size_t columns, size_t rows, const lod_window& window, uint8_t* out, ThreadPool& pool){
+        density_bands(columns, rows, window, out, pool, [&](size_t y, size_t w0, size_t words, std::vector<uint64_t>& scratch){
+            size_t x0 = w0 * 64;
+            scratch.resize(words);
+            pack_cells(cells + (y * columns) + x0, std::min(columns - x0, words * 64), 1, scratch.data());
+            return (const uint64_t*) scratch.data();
+        });
+}
+
+// The window of level window.level from the rows of the bitpack engine, row_words words
+// to a row, which are counted as they are.
+void lod_density_packed(const uint64_t* words, size_t row_words, size_t columns, size_t rows, const lod_window& window, uint8_t* out, ThreadPool& pool){
+        density_bands(columns, rows, window, out, pool, [&](size_t y, size_t w0, size_t, std::vector<uint64_t>&){
+            return words + (y * row_words) + w0;
+        });
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "thread_pool.h"
+
+#define LOD_LEVELS_MAX 8        // Level l holds one value per 2^l x 2^l block of cells.
+#define LOD_BAND_ROWS 16        // Output rows per pool job.
+#define LOD_WINDOW_MARGIN 64    // Blocks snapshotted around the visible ones, so small pans need no new window.
+
+
+// Blocks [x0, x1) x [y0, y1) of one pyramid level; the blocks of level 0 are cells.
+struct lod_window{
+    size_t level;
+    size_t x0;
+    size_t y0;
+    size_t x1;
+    size_t y1;
+};
+
+// Downsampled live-cell density of a grid, for drawing it zoomed out past one cell per
+// pixel. Level l has one byte per 2^l x 2^l block: 0 when the block is empty, otherwise
+// its live fraction scaled to 1..255 and rounded up, so a lone cell never disappears.
+// Only state 1 counts as live. A level is computed straight from the cells, and only over
+// the window being drawn, so the cost follows the view rather than the grid.
+size_t lod_levels(size_t columns, size_t rows, size_t field_w, size_t field_h);
+size_t lod_blocks(size_t cells, size_t level);
+void lod_density(const uint8_t* cells, size_t columns, size_t rows, const lod_window& window, uint8_t* out, ThreadPool& pool);
+void lod_density_packed(const uint64_t* words, size_t row_words, size_t columns, size_t rows, const lod_window& window, uint8_t* out, ThreadPool& pool);
@@ -0,0 +1,87 @@
+#include "ltl_engine.h"
+
+
+LtlEngine::LtlEngine() :
+        m_columns(0), m_rows(0), m_rule()
+    {
+}
+
+void LtlEngine::resize(size_t columns, size_t rows){
+        m_columns = columns;
+        m_rows = rows;
+        reserve_sums();
+}
+
+void LtlEngine::set_rule(const rule_t& rule){
+        m_rule = rule;
+        reserve_sums();
+}
+
+// The row sums take two bytes per cell, so they only exist while a range above 1 is set.
+void LtlEngine::reserve_sums(){
+        if (m_rule.range > 1){
+            m_row_sums.resize(m_columns * m_rows);
+        }else{
+            std::vector<uint16_t>().swap(m_row_sums);
+        }
+}
+
+// Rows y0..y1 of m_row_sums. Each row is copied with R cells of wrap on either side so the
+// window slides without a modulo per cell.
+void LtlEngine::sum_rows(const uint8_t* cells, size_t y0, size_t y1){
+        const size_t r = m_rule.range;
+        std::vector<uint8_t> padded(m_columns + (2 * r));
+        for (size_t y=y0; y<y1; y++){
+            const uint8_t* row = cells + (y * m_columns);
+            for (size_t i=0; i<r; i++){
+                padded[i] = row[(m_columns - r + i) % m_columns];
+                padded[r + m_columns + i] = row[i % m_columns];
+            }
+            std::copy(row, row + m_columns, padded.begin() + r);
+
+            uint16_t* out = m_row_sums.data() + (y * m_columns);
+            uint16_t sum = 0;
+            for (size_t i=0; i<2*r; i++){
+                sum += padded[i];
+            }
+            for (size_t x=0; x<m_columns; x++){
+                sum += padded[x + (2 * r)];
+                out[x] = sum;
+                sum -= padded[x];
+            }
+        }
+}
+
+// Rows y0..y1 of the next generation, from m_row_sums of the whole grid. The column sums
+// are seeded once for y0 and then slid down the band.
+void LtlEngine::step_rows(const uint8_t* cells, uint8_t* next, size_t y0, size_t y1){
+        const size_t r = m_rule.range;
+        const uint16_t middle = m_rule.middle;
+        const uint16_t b_min = m_rule.birth_min, b_span = m_rule.birth_max - m_rule.birth_min;
+        const uint16_t s_min = m_rule.survive_min, s_span = m_rule.survive_max - m_rule.survive_min;
+        std::vector<uint16_t> sums(m_columns, 0);
+        for (size_t i=0; i<=2*r; i++){
+            const uint16_t* row = m_row_sums.data() + (((y0 + m_rows * r + i - r) % m_rows) * m_columns);
+            for (size_t x=0; x<m_columns; x++){
+                sums[x] += row[x];
+            }
+        }
+        for (size_t y=y0; y<y1; y++){
+            const uint8_t* cur = cells + (y * m_columns);
+            uint8_t* nxt = next + (y * m_columns);
+            for (size_t x=0; x<m_columns; x++){
+                // Unsigned wrap-around turns each interval test into one compare.
+                uint16_t n = sums[x] - (cur[x] & (middle ^ 1));
+                uint16_t born = (uint16_t)(n - b_min) <= b_span;
+                uint16_t kept = (uint16_t)(n - s_min) <= s_span;
+                nxt[x] = cur[x] ? kept : born;
+            }
+            if (y + 1 < y1){
+                const uint16_t* enter = m_row_sums.data() + (((y + r + 1) % m_rows) * m_columns);
+                const uint16_t* leave = m_row_sums.data() + (((y + m_rows - r) % m_rows) * m_columns);
+                for (size_t x=0; x<m_columns; x++){
+                    sums[x] += enter[x] - leave[x];
+                }
+            }
+        }
+}
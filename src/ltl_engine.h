@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "rules.h"
+
+
+// Larger-than-Life engine: counts the (2R+1)^2 box around every cell of a torus with two
+// sliding windows, so a step costs the same for any range. sum_rows() slides a window of
+// 2R+1 cells along each row; step_rows() keeps one running sum per column over 2R+1 of
+// those row sums, adding the row entering the window and subtracting the one leaving it.
+class LtlEngine{
+    private:
+        size_t m_columns;
+        size_t m_rows;
+        rule_t m_rule;
+        std::vector<uint16_t> m_row_sums;   // Horizontal window sum of every cell.
+
+        void reserve_sums();
+
+    public:
+        LtlEngine();
+        void resize(size_t columns, size_t rows);
+        void set_rule(const rule_t& rule);
+        void sum_rows(const uint8_t* cells, size_t y0, size_t y1);
+        void step_rows(const uint8_t* cells, uint8_t* next, size_t y0, size_t y1);
+};
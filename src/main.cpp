@@ -5,54 +5,187 @@
 #include <raymath.h>
 #include <string.h>
 #include <string>
+#include <sys/stat.h>
 #include <vector>
 #include "c_logger.h"
+#include "frame_capture.h"
 #include "rgb_table.h"
+#include "sim_thread.h"
 #include "world.h"
 
-static char log_buffer[1024];
-
-const char screenshot_path[] = "screenshots/take_6/";
-
 #define RAYLIB_ENABLED 1
 #define SCREEN_W 1920
 #define SCREEN_H 1080
-#define GRID_CELL_SIZE 12
 #define ENABLE_SCREEN_CAPTURE 0
-#define RANDOM_SEED 1
-
-void capture_screen(){
-    static size_t capture_count = 0;
-    if (capture_count < 1000){
-        char file_name[255];
-        sprintf(file_name, "%sscreen_%ld.png", screenshot_path, capture_count);
-        TakeScreenshot(file_name);
-        sprintf(log_buffer, "%s: '%s'.", __func__, file_name);
-        capture_count++;
-        logger(log_buffer, 4);
+#define RANDOM_SEED 1            // Seed from the clock unless --seed is given.
+#define PAN_STEP 4
+#define PATTERN_DIR "patterns/"
+
+FrameCapture capture;
+size_t screen_w = SCREEN_W;
+size_t screen_h = SCREEN_H;
+size_t grid_w = 0;              // Cells; 0 fits the window at the cell size.
+size_t grid_h = 0;
+size_t cell_size = GRID_CELL_SIZE;
+const char* rule_text = NULL;
+int threads = -1;
+bool jump_set = false;
+int jump_log2 = 0;
+size_t hashlife_nodes = 0;
+double sim_rate = -1;
+const char* pattern_path = NULL;
+int64_t pattern_x = PATTERN_CENTRE;
+int64_t pattern_y = PATTERN_CENTRE;
+const char* state_path = STATE_PATH;
+bool state_load = false;
+uint64_t seed = 0;
+bool seed_set = false;
+
+void print_usage(const char* name){
+    fprintf(stderr, "Usage: %s [--window WxH] [--width N] [--height N] [--cell-size N] [--rule B3/S23] [--threads N] [--jump LOG2] [--hashlife-nodes N] [--sim-rate N] [--seed N] [--pattern FILE] [--pattern-at X,Y] [--state FILE] [--capture-dir DIR] [--capture-wait]\n", name);
+}
+
+int parse_args(int argc, char** argv){
+    for (int i=1; i<argc; i++){
+        if (strcmp(argv[i], "--window") == 0 && i + 1 < argc){
+            if (sscanf(argv[++i], "%ldx%ld", &screen_w, &screen_h) != 2 || screen_h <= HUD_H){
+                print_usage(argv[0]);
+                return -1;
+            }
+        }else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc){
+            grid_w = strtoul(argv[++i], NULL, 10);
+        }else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc){
+            grid_h = strtoul(argv[++i], NULL, 10);
+        }else if (strcmp(argv[i], "--cell-size") == 0 && i + 1 < argc){
+            cell_size = strtoul(argv[++i], NULL, 10);
+        }else if (strcmp(argv[i], "--rule") == 0 && i + 1 < argc){
+            rule_text = argv[++i];
+        }else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+            threads = atoi(argv[++i]);
+        }else if (strcmp(argv[i], "--jump") == 0 && i + 1 < argc){
+            jump_log2 = atoi(argv[++i]);
+            jump_set = true;
+        }else if (strcmp(argv[i], "--hashlife-nodes") == 0 && i + 1 < argc){
+            hashlife_nodes = strtoul(argv[++i], NULL, 10);
+        }else if (strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc){
+            sim_rate = atof(argv[++i]);
+        }else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc){
+            seed = strtoull(argv[++i], NULL, 0);
+            seed_set = true;
+        }else if (strcmp(argv[i], "--pattern") == 0 && i + 1 < argc){
+            pattern_path = argv[++i];
+        }else if (strcmp(argv[i], "--pattern-at") == 0 && i + 1 < argc){
+            if (sscanf(argv[++i], "%ld,%ld", &pattern_x, &pattern_y) != 2){
+                print_usage(argv[0]);
+                return -1;
+            }
+        }else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc){
+            state_path = argv[++i];
+            state_load = true;
+        }else if (strcmp(argv[i], "--capture-dir") == 0 && i + 1 < argc){
+            capture.set_dir(argv[++i]);
+        }else if (strcmp(argv[i], "--capture-wait") == 0){
+            capture.set_blocking(true);
+        }else{
+            print_usage(argv[0]);
+            return -1;
+        }
     }
+    return 0;
 }
 
-    
-World world(SCREEN_H, SCREEN_W, GRID_CELL_SIZE);
+// Saves the grid as patterns/gen_<generation>.rle. Runs on the simulation thread.
+void save_pattern(World& w){
+    char path[255];
+    mkdir(PATTERN_DIR, 0755);
+    snprintf(path, sizeof(path), "%sgen_%lu.rle", PATTERN_DIR, w.get_stats().generation);
+    w.save_pattern(path);
+}
 
-int main(){
+int main(int argc, char** argv){
+
+    if (parse_args(argc, argv) != 0){
+        return 1;
+    }
+    // Built here rather than at static-init time so the grid size can come from the
+    // command line; the World still outlives the window.
+    World world(screen_h, screen_w, cell_size, grid_w, grid_h);
+    if (world.get_cell_size() != cell_size || (grid_w && world.get_columns() != grid_w) || (grid_h && world.get_rows() != grid_h)){
+        fprintf(stderr, "Invalid grid %ldx%ld with cell size %ld.\n", grid_w, grid_h, cell_size);
+        return 1;
+    }
+    SimThread sim(world);
+    if (rule_text && !world.set_rule_string(rule_text)){
+        fprintf(stderr, "Invalid rule '%s'.\n", rule_text);
+        return 1;
+    }
+    if (threads >= 0){
+        world.set_threads(threads);
+    }
+    if (jump_set){
+        world.set_jump_log2(jump_log2);
+    }
+    if (hashlife_nodes){
+        world.set_hashlife_node_limit(hashlife_nodes);
+    }
+    if (sim_rate >= 0){
+        sim.set_rate(sim_rate);
+    }
+    if (!seed_set && RANDOM_SEED){
+        seed = splitmix64(time(NULL));
+    }
+    if (seed_set || RANDOM_SEED){
+        world.set_seed(seed);
+    }
+    if (pattern_path && !world.load_pattern(pattern_path, pattern_x, pattern_y)){
+        fprintf(stderr, "Cannot load pattern '%s'.\n", pattern_path);
+        return 1;
+    }
+    if (state_load && !world.load_state(state_path)){
+        fprintf(stderr, "Cannot load state '%s'.\n", state_path);
+        return 1;
+    }
 
-    if (RANDOM_SEED){
-        srand(time(NULL));
+    if (ENABLE_SCREEN_CAPTURE){
+        capture.start();
     }
-    InitWindow(SCREEN_W, SCREEN_H, "Tiles");
+    InitWindow(screen_w, screen_h, "Tiles");
     SetTargetFPS(60);
     ToggleBorderlessWindowed();
     bool wait_for_r_digit = 0;
     bool wait_for_mode = 0;
+    // Recording copies every generation on the simulation thread, so none are skipped between frames.
+    sim.set_generation_hook([](World& w){
+        if (capture.is_running()){
+            capture.push([&](capture_frame& frame){
+                w.copy_grid(frame.cells, frame.births, &frame.birth_now);
+                frame.states = w.get_rule().states;
+                frame.columns = w.get_columns();
+                frame.rows = w.get_rows();
+                frame.generation = w.get_stats().generation;
+            });
+        }
+    });
+    sim.start();
     while (WindowShouldClose() == false){
         BeginDrawing();
+        // The World belongs to the simulation thread; every edit below is posted to it.
         if (IsMouseButtonPressed(0)){
-            world.act_on_mouse(0);
+            int cell = world.get_mouse_cell();
+            sim.post([cell](World& w){ w.set_cell(cell, 1); });
         }
         if (IsMouseButtonPressed(1)){
-            world.act_on_mouse(1);
+            int cell = world.get_mouse_cell();
+            sim.post([cell](World& w){ w.set_cell(cell, 0); });
+        }
+        // The camera is render-side state, so zoom and drag apply directly.
+        float wheel = GetMouseWheelMove();
+        if (wheel != 0){
+            world.zoom_camera(wheel, GetMouseX(), GetMouseY());
+        }
+        if (IsMouseButtonDown(2)){
+            Vector2 delta = GetMouseDelta();
+            world.drag_camera(delta.x, delta.y);
         }
 
         if(IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_Q)){
@@ -64,10 +197,11 @@ int main(){
         }
         if (wait_for_r_digit == 1){
             int c;
-            world.prompt_digit();
+            sim.post([](World& w){ w.prompt_digit(); });
             while ((c = GetCharPressed()) != 0){
                 if (c>='0' && c <= '9'){
-                    world.randomize_cells(c-'0');
+                    uint8_t digit = c - '0';
+                    sim.post([digit](World& w){ w.randomize_cells(digit); });
                     wait_for_r_digit = 0;
                     break;
                 }
@@ -75,64 +209,153 @@ int main(){
         }
 
         if (wait_for_mode == 1){
-            //int c;
-            world.prompt_mode();
-            //while ((c = GetCharPressed()) != 0){
-                if (IsKeyPressed(KEY_UP)){
-                    sprintf(log_buffer, "%s: key up.", __func__ );
-                    logger(log_buffer, 4);
-                    world.set_mode(1);
-                }
-                if (IsKeyPressed(KEY_DOWN)){
-                    sprintf(log_buffer, "%s: key down.", __func__ );
-                    logger(log_buffer, 4);
-                    world.set_mode(-1);
-                }
-                if (IsKeyPressed(KEY_ENTER)){
-                    sprintf(log_buffer, "%s: enter.", __func__ );
-                    logger(log_buffer, 4);
-                    world.set_mode(0);
-                    wait_for_mode = 0;
+            int c;
+            sim.post([](World& w){ w.prompt_mode(); });
+            while ((c = GetCharPressed()) != 0){
+                // Digits past 8 and C only appear in Generations state counts (B2/S/C3).
+                if ((c >= '0' && c <= '9') || c == '/' || c == 'b' || c == 'B' || c == 's' || c == 'S' || c == 'c' || c == 'C'){
+                    sim.post([c](World& w){ w.rule_input_push(c); });
                 }
-            //}
+            }
+            if (IsKeyPressed(KEY_BACKSPACE)){
+                sim.post([](World& w){ w.rule_input_pop(); });
+            }
+            if (IsKeyPressed(KEY_UP)){
+                LOG(4, "%s: key up.", __func__);
+                sim.post([](World& w){ w.set_mode(1); });
+            }
+            if (IsKeyPressed(KEY_DOWN)){
+                LOG(4, "%s: key down.", __func__);
+                sim.post([](World& w){ w.set_mode(-1); });
+            }
+            if (IsKeyPressed(KEY_ENTER)){
+                LOG(4, "%s: enter.", __func__);
+                sim.post([](World& w){ w.set_mode(0); });
+                wait_for_mode = 0;
+            }
         }
 
         ClearBackground(COL_BLACK);
 
-        if (!IsKeyDown(KEY_LEFT_SHIFT) &&  IsKeyPressed(KEY_R)){
-            world.run();
-        }
-        if (IsKeyPressed(KEY_C)){
-            world.clear();
-        }
+        // Single-key commands are suspended while a rule is typed at the mode prompt.
+        if (!wait_for_mode){
+            if (!IsKeyDown(KEY_LEFT_SHIFT) &&  IsKeyPressed(KEY_R)){
+                sim.post([](World& w){ w.run(); });
+            }
+            if (IsKeyPressed(KEY_C)){
+                sim.post([](World& w){ w.clear(); });
+            }
 
-        if (IsKeyPressed(KEY_G)){
-            world.gradient();
-        }
+            if (IsKeyPressed(KEY_G)){
+                sim.post([](World& w){ w.gradient(); });
+            }
 
-        if (IsKeyPressed(KEY_M)){
-            wait_for_mode = 1;
-        }
+            if (IsKeyPressed(KEY_M)){
+                wait_for_mode = 1;
+            }
+
+            if (IsKeyPressed(KEY_E)){
+                sim.post([](World& w){ w.next_engine(); });
+            }
+
+            if (IsKeyPressed(KEY_T)){
+                sim.post([](World& w){ w.toggle_tiles(); });
+            }
+
+            if (IsKeyPressed(KEY_U)){
+                sim.post([](World& w){ w.toggle_unbounded(); });
+            }
+            if (IsKeyDown(KEY_LEFT)){
+                sim.post([](World& w){ w.pan(-PAN_STEP, 0); });
+            }
+            if (IsKeyDown(KEY_RIGHT)){
+                sim.post([](World& w){ w.pan(PAN_STEP, 0); });
+            }
+            if (IsKeyDown(KEY_UP)){
+                sim.post([](World& w){ w.pan(0, -PAN_STEP); });
+            }
+            if (IsKeyDown(KEY_DOWN)){
+                sim.post([](World& w){ w.pan(0, PAN_STEP); });
+            }
 
-        if (IsKeyPressed(KEY_S)){
-            world.stop();
+            if (IsKeyPressed(KEY_LEFT_BRACKET)){
+                sim.post([](World& w){ w.change_cell_size(-1); });
+            }
+            if (IsKeyPressed(KEY_RIGHT_BRACKET)){
+                sim.post([](World& w){ w.change_cell_size(1); });
+            }
+
+            if (IsKeyPressed(KEY_HOME)){
+                world.reset_camera();
+            }
+
+            if (IsKeyPressed(KEY_J)){
+                sim.post([](World& w){ w.jump(); });
+            }
+            if (IsKeyPressed(KEY_COMMA)){
+                sim.post([](World& w){ w.change_jump_log2(-1); });
+            }
+            if (IsKeyPressed(KEY_PERIOD)){
+                sim.post([](World& w){ w.change_jump_log2(1); });
+            }
+
+            if (IsKeyPressed(KEY_EQUAL) || IsKeyPressed(KEY_KP_ADD)){
+                sim.change_speed(1);
+            }
+            if (IsKeyPressed(KEY_MINUS) || IsKeyPressed(KEY_KP_SUBTRACT)){
+                sim.change_speed(-1);
+            }
+
+            if (IsKeyPressed(KEY_L) && pattern_path){
+                sim.post([](World& w){ w.load_pattern(pattern_path, pattern_x, pattern_y); });
+            }
+            if (IsKeyPressed(KEY_P)){
+                sim.post(save_pattern);
+            }
+
+            if (IsKeyPressed(KEY_O)){
+                sim.post([](World& w){ w.toggle_stop_on_period(); });
+            }
+
+            if (IsKeyPressed(KEY_F5)){
+                sim.post([](World& w){ w.save_state(state_path); });
+            }
+            if (IsKeyPressed(KEY_F9)){
+                sim.post([](World& w){ w.load_state(state_path); });
+            }
+
+            if (IsKeyPressed(KEY_V)){
+                capture.toggle();
+            }
+
+            if (IsKeyPressed(KEY_S)){
+                sim.post([](World& w){ w.stop(); });
+            }
+
+            if (IsKeyPressed(KEY_SPACE)){
+                sim.post([](World& w){ w.toggle_rs(); });
+            }
         }
-        
-        if (IsKeyPressed(KEY_SPACE)){
-            world.toggle_rs();
+
+        const world_snapshot& snap = sim.acquire();
+        world.draw(snap);
+        // Snapshots only hold what the camera shows, so a view that moved off it asks for a new window.
+        lod_window window;
+        if (world.take_view_window(&window)){
+            sim.post([window](World& w){ w.set_view_window(window); });
         }
 
-        world.draw();
+        if (capture.is_running()){
+            char text_buffer[255];
+            sprintf(text_buffer, "REC written: %ld  dropped: %ld  queued: %ld/%d", capture.get_written(), capture.get_dropped(), capture.get_pending(), CAPTURE_SLOTS);
+            DrawText(text_buffer, screen_w / 2, screen_h - 20, 16, COL_RED);
+        }
 
         EndDrawing();
-        if (ENABLE_SCREEN_CAPTURE){
-            if (world.get_state() == _RUN){
-                capture_screen();
-            }
-        }
     }
+    sim.stop();
+    capture.stop();
     CloseWindow();
-    sprintf(log_buffer, "Main is done.");
-    logger(log_buffer, 4);
+    LOG(4, "Main is done.");
     return 0;
 }
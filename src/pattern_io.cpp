@@ -0,0 +1,494 @@
+#include "pattern_io.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "c_logger.h"
+
+
+static inline bool is_blank(char c){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char* line_end(const char* p, const char* end){
+    if (p >= end){
+        return end;
+    }
+    const char* eol = (const char*) memchr(p, '\n', end - p);
+    return eol ? eol : end;
+}
+
+static inline const char* skip_line(const char* p, const char* end){
+    const char* eol = line_end(p, end);
+    return (eol < end) ? eol + 1 : end;
+}
+
+// Parses an optionally signed decimal after leading blanks. Returns p unchanged if there is none.
+static const char* parse_int(const char* p, const char* end, int64_t* value){
+    const char* q = p;
+    while (q < end && is_blank(*q)){ q++; }
+    bool negative = (q < end && *q == '-');
+    if (q < end && (*q == '-' || *q == '+')){ q++; }
+    if (q >= end || *q < '0' || *q > '9'){
+        return p;
+    }
+    int64_t v = 0;
+    while (q < end && *q >= '0' && *q <= '9'){
+        v = (v * 10) + (*q - '0');
+        q++;
+    }
+    *value = negative ? -v : v;
+    return q;
+}
+
+// Copies a rule value up to the end of the line, dropping RLE's ":T<w>,<h>" bounded-grid
+// suffix. Commas are kept: Larger-than-Life rules are written "R5,C0,M1,...".
+static void copy_rule(char* dst, const char* p, const char* eol){
+    while (p < eol && is_blank(*p)){ p++; }
+    size_t n = 0;
+    while (p < eol && *p != ':' && !is_blank(*p) && n < RULE_NAME_LEN - 1){
+        dst[n++] = *p++;
+    }
+    dst[n] = '\0';
+}
+
+
+int pattern_format_of(const char* path){
+    const char* dot = strrchr(path, '.');
+    if (!dot){
+        return _PATTERN_UNKNOWN;
+    }
+    if (strcasecmp(dot, ".rle") == 0){
+        return _PATTERN_RLE;
+    }
+    if (strcasecmp(dot, ".lif") == 0 || strcasecmp(dot, ".life") == 0){
+        return _PATTERN_LIFE106;
+    }
+    if (strcasecmp(dot, ".cells") == 0 || strcasecmp(dot, ".txt") == 0){
+        return _PATTERN_PLAINTEXT;
+    }
+    return _PATTERN_UNKNOWN;
+}
+
+
+PatternReader::PatternReader() :
+        m_fd(-1), m_data(nullptr), m_size(0), m_body(nullptr), m_format(_PATTERN_UNKNOWN),
+        m_width(0), m_height(0), m_min_x(0), m_min_y(0)
+    {
+        m_rule[0] = '\0';
+}
+
+PatternReader::~PatternReader(){
+        close();
+}
+
+void PatternReader::close(){
+        if (m_data){
+            munmap((void*) m_data, m_size);
+            m_data = nullptr;
+        }
+        if (m_fd >= 0){
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        m_size = 0;
+        m_format = _PATTERN_UNKNOWN;
+        m_width = 0;
+        m_height = 0;
+        m_rule[0] = '\0';
+}
+
+bool PatternReader::open(const char* path){
+        close();
+        m_fd = ::open(path, O_RDONLY);
+        if (m_fd < 0){
+            LOG(2, "%s: cannot open '%s'.", __func__, path);
+            return false;
+        }
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || st.st_size == 0){
+            LOG(2, "%s: '%s' is empty.", __func__, path);
+            close();
+            return false;
+        }
+        m_size = st.st_size;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (data == MAP_FAILED){
+            LOG(2, "%s: cannot map '%s'.", __func__, path);
+            m_data = nullptr;
+            close();
+            return false;
+        }
+        m_data = (const char*) data;
+        madvise(data, m_size, MADV_SEQUENTIAL);
+
+        // The contents decide the format; the extension only breaks a tie.
+        const char* end = m_data + m_size;
+        const char* p = m_data;
+        while (p < end && (*p == '#' || *p == '\n' || *p == '\r') && (end - p < 10 || strncmp(p, "#Life 1.06", 10) != 0)){
+            p = skip_line(p, end);
+        }
+        if (end - p >= 10 && strncmp(p, "#Life 1.06", 10) == 0){
+            m_format = _PATTERN_LIFE106;
+        }else if (p < end && *p == 'x'){
+            m_format = _PATTERN_RLE;
+        }else if (p < end && (*p == '!' || *p == '.' || *p == 'O')){
+            m_format = _PATTERN_PLAINTEXT;
+        }else{
+            m_format = pattern_format_of(path);
+        }
+
+        bool ok = true;
+        switch (m_format){
+            case _PATTERN_RLE:
+                ok = parse_rle_header();
+                break;
+            case _PATTERN_LIFE106:
+                scan_life106();
+                break;
+            case _PATTERN_PLAINTEXT:
+                scan_plaintext();
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok){
+            LOG(2, "%s: '%s' is not a pattern file.", __func__, path);
+            close();
+            return false;
+        }
+        LOG(4, "%s: '%s': format: %d, %ldx%ld, rule: '%s'.", __func__, path, m_format, m_width, m_height, m_rule);
+        return true;
+}
+
+int PatternReader::get_format(){
+        return m_format;
+}
+
+int64_t PatternReader::get_width(){
+        return m_width;
+}
+
+int64_t PatternReader::get_height(){
+        return m_height;
+}
+
+// Empty unless the header named a rule.
+const char* PatternReader::get_rule(){
+        return m_rule;
+}
+
+// Returns the number of live cells passed to run.
+size_t PatternReader::read(const pattern_run_fn& run){
+        switch (m_format){
+            case _PATTERN_RLE:
+                return read_rle(run);
+            case _PATTERN_LIFE106:
+                return read_life106(run);
+            case _PATTERN_PLAINTEXT:
+                return read_plaintext(run);
+        }
+        return 0;
+}
+
+// "x = 3, y = 3, rule = B3/S23" after any '#' lines; an XLife "#r 23/3" line also sets the rule.
+bool PatternReader::parse_rle_header(){
+        const char* end = m_data + m_size;
+        const char* p = m_data;
+        while (p < end && *p != 'x'){
+            if (p[0] == '#' && p + 1 < end && p[1] == 'r'){
+                copy_rule(m_rule, p + 2, line_end(p, end));
+            }
+            p = skip_line(p, end);
+        }
+        const char* eol = line_end(p, end);
+        bool have_x = false, have_y = false;
+        while (p < eol){
+            while (p < eol && (is_blank(*p) || *p == ',')){ p++; }
+            const char* key = p;
+            while (p < eol && *p != '=' && !is_blank(*p)){ p++; }
+            size_t key_len = p - key;
+            while (p < eol && (is_blank(*p) || *p == '=')){ p++; }
+            if (key_len == 1 && key[0] == 'x'){
+                have_x = parse_int(p, eol, &m_width) != p;
+            }else if (key_len == 1 && key[0] == 'y'){
+                have_y = parse_int(p, eol, &m_height) != p;
+            }else if (key_len == 4 && strncmp(key, "rule", 4) == 0){
+                // Always the last key, and its value may hold commas.
+                copy_rule(m_rule, p, eol);
+                break;
+            }
+            while (p < eol && *p != ','){ p++; }
+        }
+        m_body = (eol < end) ? eol + 1 : end;
+        return have_x && have_y;
+}
+
+// Life 1.06 has no size in the header, so a first pass finds the bounding box.
+void PatternReader::scan_life106(){
+        const char* end = m_data + m_size;
+        const char* p = m_data;
+        while (p < end && *p == '#'){
+            p = skip_line(p, end);
+        }
+        m_body = p;
+        int64_t min_x = INT64_MAX, min_y = INT64_MAX, max_x = INT64_MIN, max_y = INT64_MIN;
+        while (p < end){
+            int64_t x, y;
+            const char* q = parse_int(p, end, &x);
+            const char* r = (q != p) ? parse_int(q, end, &y) : q;
+            if (r != q){
+                min_x = std::min(min_x, x);
+                max_x = std::max(max_x, x);
+                min_y = std::min(min_y, y);
+                max_y = std::max(max_y, y);
+            }
+            p = skip_line(r, end);
+        }
+        if (max_x >= min_x){
+            m_min_x = min_x;
+            m_min_y = min_y;
+            m_width = (max_x - min_x) + 1;
+            m_height = (max_y - min_y) + 1;
+        }
+}
+
+// Every line that is not a '!' comment is a row; the widest one sets the width.
+void PatternReader::scan_plaintext(){
+        const char* end = m_data + m_size;
+        const char* p = m_data;
+        m_body = p;
+        while (p < end){
+            const char* eol = line_end(p, end);
+            if (*p != '!'){
+                const char* last = eol;
+                while (last > p && is_blank(last[-1])){ last--; }
+                m_width = std::max(m_width, (int64_t)(last - p));
+                m_height++;
+            }
+            p = (eol < end) ? eol + 1 : end;
+        }
+}
+
+// Counts prefix the next tag; 'b' is dead, 'o' is live, '$' ends a row and '!' the pattern.
+// In multi-state RLE 'A' is state 1, the only live one; 'B'.. and the 'p'..'y' prefixed
+// states above 24 are the dying states of Generations rules and load as dead. Line breaks
+// may fall anywhere between tokens.
+size_t PatternReader::read_rle(const pattern_run_fn& run){
+        const char* end = m_data + m_size;
+        int64_t x = 0, y = 0, n = 0;
+        size_t cells = 0;
+        bool high = false;      // Saw a 'p'..'y' prefix, so the next letter is above state 24.
+        for (const char* p=m_body; p<end; p++){
+            char c = *p;
+            if (c >= 'p' && c <= 'y'){
+                high = true;
+                continue;
+            }
+            if (c >= '0' && c <= '9'){
+                n = (n * 10) + (c - '0');
+                continue;
+            }
+            if (is_blank(c) || c == '\n'){
+                continue;
+            }
+            int64_t count = n ? n : 1;
+            n = 0;
+            if (c == 'b' || c == '.'){
+                x += count;
+            }else if (c == '$'){
+                y += count;
+                x = 0;
+            }else if (c == '!'){
+                break;
+            }else if (c == '#'){
+                p = skip_line(p, end) - 1;
+            }else if (c == 'o' || (c == 'A' && !high)){
+                run(x, y, count);
+                x += count;
+                cells += count;
+            }else if (c >= 'A' && c <= 'X'){
+                x += count;
+            }
+            high = false;
+        }
+        return cells;
+}
+
+size_t PatternReader::read_life106(const pattern_run_fn& run){
+        const char* end = m_data + m_size;
+        const char* p = m_body;
+        size_t cells = 0;
+        while (p < end){
+            int64_t x, y;
+            const char* q = parse_int(p, end, &x);
+            const char* r = (q != p) ? parse_int(q, end, &y) : q;
+            if (r != q){
+                run(x - m_min_x, y - m_min_y, 1);
+                cells++;
+            }
+            p = skip_line(r, end);
+        }
+        return cells;
+}
+
+size_t PatternReader::read_plaintext(const pattern_run_fn& run){
+        const char* end = m_data + m_size;
+        const char* p = m_body;
+        int64_t y = 0;
+        size_t cells = 0;
+        while (p < end){
+            const char* eol = line_end(p, end);
+            if (*p != '!'){
+                const char* q = p;
+                while (q < eol){
+                    if (*q != 'O' && *q != '*'){
+                        q++;
+                        continue;
+                    }
+                    const char* start = q;
+                    while (q < eol && (*q == 'O' || *q == '*')){ q++; }
+                    run(start - p, y, q - start);
+                    cells += q - start;
+                }
+                y++;
+            }
+            p = (eol < end) ? eol + 1 : end;
+        }
+        return cells;
+}
+
+
+struct rle_writer{
+    FILE* file;
+    size_t line;
+};
+
+// Writes one "<count><tag>" token, starting a new line first if it would not fit.
+static void rle_put(rle_writer* w, int64_t count, char tag){
+    char token[24];
+    int len = (count > 1) ? snprintf(token, sizeof(token), "%ld%c", count, tag) : snprintf(token, sizeof(token), "%c", tag);
+    if (w->line + len > PATTERN_LINE_LEN){
+        fputc('\n', w->file);
+        w->line = 0;
+    }
+    fwrite(token, 1, len, w->file);
+    w->line += len;
+}
+
+static void write_rle(FILE* file, const uint8_t* cells, size_t columns, size_t x0, size_t x1, size_t y0, size_t y1, const char* rule){
+    fprintf(file, "x = %ld, y = %ld, rule = %s\n", (y1 > y0) ? x1 - x0 : 0, y1 - y0, rule);
+    rle_writer w = {file, 0};
+    int64_t rows_ended = 0;
+    for (size_t y=y0; y<y1; y++){
+        const uint8_t* row = cells + (y * columns);
+        if (y > y0){
+            rows_ended++;
+        }
+        size_t x = x0;
+        while (x < x1){
+            size_t dead = x;
+            while (dead < x1 && row[dead] != 1){ dead++; }
+            if (dead == x1){
+                break;
+            }
+            size_t live = dead;
+            while (live < x1 && row[live] == 1){ live++; }
+            if (rows_ended){
+                rle_put(&w, rows_ended, '$');
+                rows_ended = 0;
+            }
+            if (dead > x){
+                rle_put(&w, dead - x, 'b');
+            }
+            rle_put(&w, live - dead, 'o');
+            x = live;
+        }
+    }
+    rle_put(&w, 1, '!');
+    fputc('\n', file);
+}
+
+static void write_life106(FILE* file, const uint8_t* cells, size_t columns, size_t x0, size_t x1, size_t y0, size_t y1){
+    fprintf(file, "#Life 1.06\n");
+    for (size_t y=y0; y<y1; y++){
+        for (size_t x=x0; x<x1; x++){
+            if (cells[(y * columns) + x] == 1){
+                fprintf(file, "%ld %ld\n", x - x0, y - y0);
+            }
+        }
+    }
+}
+
+static void write_plaintext(FILE* file, const char* path, const uint8_t* cells, size_t columns, size_t x0, size_t x1, size_t y0, size_t y1){
+    const char* name = strrchr(path, '/');
+    fprintf(file, "!Name: %s\n", name ? name + 1 : path);
+    std::vector<char> line(x1 - x0 + 1);
+    for (size_t y=y0; y<y1; y++){
+        const uint8_t* row = cells + (y * columns);
+        size_t n = 0;
+        for (size_t x=x0; x<x1; x++){
+            line[x - x0] = (row[x] == 1) ? 'O' : '.';
+            if (row[x] == 1){
+                n = (x - x0) + 1;
+            }
+        }
+        line[n] = '\n';
+        fwrite(line.data(), 1, n + 1, file);
+    }
+}
+
+// Writes the bounding box of the live cells in the format named by the extension. As in
+// state files only state 1 is live; the dying states of Generations rules are left out.
+bool write_pattern(const char* path, const uint8_t* cells, size_t columns, size_t rows, const char* rule){
+    int format = pattern_format_of(path);
+    if (format == _PATTERN_UNKNOWN){
+        LOG(2, "%s: unknown pattern extension '%s'.", __func__, path);
+        return false;
+    }
+    FILE* file = fopen(path, "w");
+    if (!file){
+        LOG(2, "%s: cannot write '%s'.", __func__, path);
+        return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+    size_t x0 = columns, x1 = 0, y0 = rows, y1 = 0;
+    for (size_t y=0; y<rows; y++){
+        const uint8_t* row = cells + (y * columns);
+        const uint8_t* first = (const uint8_t*) memchr(row, 1, columns);
+        if (!first){
+            continue;
+        }
+        size_t last = columns;
+        while (row[last - 1] != 1){ last--; }
+        x0 = std::min(x0, (size_t)(first - row));
+        x1 = std::max(x1, last);
+        y0 = std::min(y0, y);
+        y1 = y + 1;
+    }
+    if (y1 == 0){
+        x0 = x1 = y0 = 0;
+    }
+
+    switch (format){
+        case _PATTERN_RLE:
+            write_rle(file, cells, columns, x0, x1, y0, y1, rule);
+            break;
+        case _PATTERN_LIFE106:
+            write_life106(file, cells, columns, x0, x1, y0, y1);
+            break;
+        case _PATTERN_PLAINTEXT:
+            write_plaintext(file, path, cells, columns, x0, x1, y0, y1);
+            break;
+    }
+    bool ok = (fclose(file) == 0);
+    LOG(ok ? 4 : 2, "%s: '%s': %ldx%ld.", __func__, path, x1 - x0, y1 - y0);
+    return ok;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "rules.h"
+
+#define PATTERN_LINE_LEN 70     // RLE lines are wrapped before this many characters.
+#define PATTERN_CENTRE INT64_MIN // Placement that centres the pattern in the grid.
+
+enum pattern_formats{
+    _PATTERN_UNKNOWN,
+    _PATTERN_RLE,
+    _PATTERN_LIFE106,
+    _PATTERN_PLAINTEXT
+};
+
+// Receives n live cells starting at (x, y), relative to the pattern's top-left corner.
+typedef std::function<void(int64_t x, int64_t y, int64_t n)> pattern_run_fn;
+
+
+// Reads RLE (.rle), Life 1.06 (.lif, .life) and plaintext (.cells) patterns from a
+// memory-mapped file. open() detects the format from the contents and reads the size and
+// rule from the header; read() then streams the live cells as horizontal runs in a single
+// pass, so nothing the size of the pattern is ever allocated.
+class PatternReader{
+    private:
+        int m_fd;
+        const char* m_data;
+        size_t m_size;
+        const char* m_body;         // First byte after the header.
+        int m_format;
+        int64_t m_width;
+        int64_t m_height;
+        int64_t m_min_x;            // Life 1.06 coordinates are absolute; this is the top-left.
+        int64_t m_min_y;
+        char m_rule[RULE_NAME_LEN];
+
+        bool parse_rle_header();
+        void scan_life106();
+        void scan_plaintext();
+        size_t read_rle(const pattern_run_fn& run);
+        size_t read_life106(const pattern_run_fn& run);
+        size_t read_plaintext(const pattern_run_fn& run);
+
+    public:
+        PatternReader();
+        ~PatternReader();
+        bool open(const char* path);
+        void close();
+        int get_format();
+        int64_t get_width();
+        int64_t get_height();
+        const char* get_rule();
+        size_t read(const pattern_run_fn& run);
+};
+
+int pattern_format_of(const char* path);
+bool write_pattern(const char* path, const uint8_t* cells, size_t columns, size_t rows, const char* rule);
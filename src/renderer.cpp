@@ -0,0 +1,78 @@
+#include "renderer.h"
+
+#include <algorithm>
+
+
+CellRenderer::CellRenderer() :
+        m_columns(0), m_rows(0), m_texture(), m_texture_w(0), m_texture_h(0), m_loaded(false)
+    {
+        for (size_t i=0; i<AGE_COLOURS; i++){
+            m_palette[i] = {rgb_values[i][0], rgb_values[i][1], rgb_values[i][2], 255};
+        }
+}
+
+// The world outlives the window, so the texture is only released while a GL context exists.
+CellRenderer::~CellRenderer(){
+        if (m_loaded && IsWindowReady()){
+            UnloadTexture(m_texture);
+        }
+}
+
+// Sets the size of the view in pixels; called every frame, so the buffer is only grown.
+void CellRenderer::resize(size_t columns, size_t rows){
+        m_columns = columns;
+        m_rows = rows;
+        m_pixels.resize(columns * rows);
+}
+
+size_t CellRenderer::get_columns(){
+        return m_columns;
+}
+
+size_t CellRenderer::get_rows(){
+        return m_rows;
+}
+
+Color* CellRenderer::get_row(size_t y){
+        return &m_pixels[y * m_columns];
+}
+
+// The texture is created on first use, once the window is certain to exist, and recreated
+// only when the view outgrows it; each frame uploads just the view.
+void CellRenderer::draw(float x0, float y0, float cell_size, Color gap_colour, Color line_colour){
+        if (!m_loaded || m_columns > m_texture_w || m_rows > m_texture_h){
+            if (m_loaded){
+                UnloadTexture(m_texture);
+            }
+            m_texture_w = std::max(m_columns, m_texture_w);
+            m_texture_h = std::max(m_rows, m_texture_h);
+            Image image = GenImageColor(m_texture_w, m_texture_h, {0, 0, 0, 0});
+            m_texture = LoadTextureFromImage(image);
+            UnloadImage(image);
+            SetTextureFilter(m_texture, TEXTURE_FILTER_POINT);
+            m_loaded = true;
+        }
+        Rectangle source = {0, 0, (float)m_columns, (float)m_rows};
+        UpdateTextureRec(m_texture, source, m_pixels.data());
+        float w = m_columns * cell_size;
+        float h = m_rows * cell_size;
+        Rectangle dest = {x0, y0, w, h};
+        DrawTexturePro(m_texture, source, dest, {0, 0}, 0, COL_WHITE);
+
+        if (cell_size >= GRID_GAP_MIN_SIZE){
+            for (size_t x=0; x<m_columns; x++){
+                DrawRectangle(x0 + (x * cell_size), y0, GRID_GAP, h, gap_colour);
+            }
+            for (size_t y=0; y<m_rows; y++){
+                DrawRectangle(x0, y0 + (y * cell_size), w, GRID_GAP, gap_colour);
+            }
+        }
+        if (cell_size > GRID_LINE_MIN_SIZE){
+            for (size_t x=0; x<=m_columns; x++){
+                DrawLine(x0 + (x * cell_size), y0, x0 + (x * cell_size), y0 + h, line_colour);
+            }
+            for (size_t y=0; y<=m_rows; y++){
+                DrawLine(x0, y0 + (y * cell_size), x0 + w, y0 + (y * cell_size), line_colour);
+            }
+        }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <raylib.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "colours.h"
+#include "rgb_table.h"
+
+#define AGE_COLOURS 360
+#define GRID_GAP 2              // Background gap left of and above every cell, as the old per-cell rectangles drew.
+#define GRID_GAP_MIN_SIZE 4     // Smaller cells are drawn without gaps.
+#define GRID_LINE_MIN_SIZE 20   // Larger cells also get a grey outline.
+
+
+// One RGBA pixel per visible cell (or pyramid block), uploaded once per frame and drawn
+// scaled with point filtering. Grid gaps and lines are drawn on top as one strip per
+// column and row, so a frame costs the same no matter how many cells are alive.
+class CellRenderer{
+    private:
+        size_t m_columns;
+        size_t m_rows;
+        std::vector<Color> m_pixels;
+        Color m_palette[AGE_COLOURS];
+        Texture2D m_texture;
+        size_t m_texture_w;         // The texture only grows; the view is its top-left corner.
+        size_t m_texture_h;
+        bool m_loaded;
+
+    public:
+        CellRenderer();
+        ~CellRenderer();
+        void resize(size_t columns, size_t rows);
+        size_t get_columns();
+        size_t get_rows();
+        Color* get_row(size_t y);
+        void draw(float x0, float y0, float cell_size, Color gap_colour, Color line_colour);
+
+        // Live cells are coloured by age along the rgb_values hue ramp; dead cells are transparent.
+        inline Color age_colour(size_t age){
+            return m_palette[(age < AGE_COLOURS) ? age : AGE_COLOURS - 1];
+        }
+
+        // Generations rules: live cells take the newborn colour and dying states spread
+        // along the rest of the ramp.
+        inline Color state_colour(uint8_t state, uint16_t states){
+            return m_palette[1 + (((size_t)state - 1) * (AGE_COLOURS - 2)) / (states - 1)];
+        }
+
+        // Pyramid blocks take the newborn colour with the block's live density as alpha.
+        inline Color density_colour(uint8_t density){
+            return {m_palette[1].r, m_palette[1].g, m_palette[1].b, density};
+        }
+};
@@ -0,0 +1,31 @@
+#include "rng.h"
+
+#include <algorithm>
+
+
+// Sets cells[i] to 1 when the sample of cell first + i is below cutoffs[i], else 0. Whole
+// blocks of four take one draw each; only a partial block at either end loops per lane.
+void random_cells(uint8_t* cells, uint64_t first, size_t n, uint64_t seed, const uint32_t* cutoffs){
+    size_t i = 0;
+    while (i < n && ((first + i) % 4 || n - i < 4)){
+        uint64_t c = first + i;
+        cells[i] = ((random_draw(seed, c / 4) >> ((c % 4) * 16)) & 0xFFFF) < cutoffs[i];
+        i++;
+    }
+    for (; i + 4 <= n; i += 4){
+        uint64_t z = random_draw(seed, (first + i) / 4);
+        cells[i]     = (uint32_t)(z & 0xFFFF) < cutoffs[i];
+        cells[i + 1] = (uint32_t)((z >> 16) & 0xFFFF) < cutoffs[i + 1];
+        cells[i + 2] = (uint32_t)((z >> 32) & 0xFFFF) < cutoffs[i + 2];
+        cells[i + 3] = (uint32_t)(z >> 48) < cutoffs[i + 3];
+    }
+    for (; i<n; i++){
+        uint64_t c = first + i;
+        cells[i] = ((random_draw(seed, c / 4) >> ((c % 4) * 16)) & 0xFFFF) < cutoffs[i];
+    }
+}
+
+// Cutoff for a live-cell ratio in [0, 1].
+uint32_t random_cutoff(double ratio){
+    return (uint32_t) std::clamp(ratio * RANDOM_ONE, 0.0, (double) RANDOM_ONE);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define RANDOM_ONE 65536        // Cutoff at which every cell is alive; samples are 16 bits.
+#define RANDOM_BAND_ROWS 64     // Rows per job when a grid is filled on the pool.
+
+
+static inline uint64_t splitmix64(uint64_t z){
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Counter-based generator: draw b of a seed is the b-th output of a SplitMix64 stream
+// started at the seed, computed directly rather than by stepping. Each draw holds the
+// 16-bit samples of four consecutive cells, so the sample of cell c depends only on the
+// seed and c, and any range of cells can be filled on its own, in any order.
+static inline uint64_t random_draw(uint64_t seed, uint64_t block){
+    return splitmix64(seed + (block * 0x9E3779B97F4A7C15ULL));
+}
+
+void random_cells(uint8_t* cells, uint64_t first, size_t n, uint64_t seed, const uint32_t* cutoffs);
+uint32_t random_cutoff(double ratio);
@@ -0,0 +1,144 @@
+#include "rules.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static const char* parse_counts(const char* p, uint16_t* mask){
+    *mask = 0;
+    while (*p >= '0' && *p <= '8'){
+        *mask |= 1 << (*p - '0');
+        p++;
+    }
+    return p;
+}
+
+static void write_counts(char* dst, uint16_t mask){
+    for (int n=0; n<9; n++){
+        if ((mask >> n) & 1){
+            *dst++ = '0' + n;
+        }
+    }
+    *dst = '\0';
+}
+
+// Larger-than-Life in Golly's notation, "R5,C0,M1,S34..58,B34..45,NM": range, states (0 or
+// 2), middle, survive and birth intervals, Moore neighbourhood. A trailing "_name" is ignored.
+static bool parse_ltl(const char* p, rule_t* rule){
+    int range, states, middle, s_min, s_max, b_min, b_max, n = 0;
+    char shape;
+    if (sscanf(p, "R%d,C%d,M%d,S%d..%d,B%d..%d,N%c%n", &range, &states, &middle, &s_min, &s_max, &b_min, &b_max, &shape, &n) != 8){
+        return false;
+    }
+    p += n;
+    if (*p != '\0' && *p != '_' && !isspace((unsigned char) *p)){
+        return false;
+    }
+    int cells = (2 * range + 1) * (2 * range + 1);
+    if (range < 1 || range > LTL_RANGE_MAX || (states != 0 && states != 2) || (middle != 0 && middle != 1)
+        || shape != 'M' || s_min < 0 || s_min > s_max || s_max > cells || b_min < 0 || b_min > b_max || b_max > cells){
+        return false;
+    }
+    memset(rule, 0, sizeof(rule_t));
+    rule->states = 2;
+    rule->range = range;
+    rule->middle = middle;
+    rule->birth_min = b_min;
+    rule->birth_max = b_max;
+    rule->survive_min = s_min;
+    rule->survive_max = s_max;
+    if (range == 1){
+        // A live cell's count includes itself under M1; a dead cell adds nothing either way.
+        for (int k=0; k<9; k++){
+            rule->birth |= (k >= b_min && k <= b_max) << k;
+            rule->survive |= (k + middle >= s_min && k + middle <= s_max) << k;
+        }
+    }
+    snprintf(rule->name, RULE_NAME_LEN, "R%u,C0,M%u,S%u..%u,B%u..%u,NM", rule->range, rule->middle,
+             rule->survive_min, rule->survive_max, rule->birth_min, rule->birth_max);
+    return true;
+}
+
+// Reads the state count of a Generations rule. Returns p unchanged when there is none.
+static const char* parse_states(const char* p, int* states){
+    int n = 0;
+    *states = 2;
+    if (sscanf(p, "%d%n", states, &n) == 1){
+        return p + n;
+    }
+    return p;
+}
+
+// Accepts "B3/S23", "b3s23", "B3_S23_CONWAY" (trailing name ignored), the classic
+// survive/birth notation "23/3" and Larger-than-Life rules. Generations rules add a state
+// count: "B2/S/C3", "B2_S_C3_NAME", or survive/birth/states "/2/3". On success the
+// canonical "B3/S23" or "B2/S/C3" form is stored in rule->name.
+bool parse_rule(const char* text, rule_t* rule){
+    uint16_t birth, survive;
+    int states = 2;
+    const char* p = text;
+    while (isspace((unsigned char) *p)){ p++; }
+
+    if (*p == 'R'){
+        return parse_ltl(p, rule);
+    }
+    if (*p == 'B' || *p == 'b'){
+        p = parse_counts(p + 1, &birth);
+        if (*p == '/' || *p == '_'){ p++; }
+        if (*p != 'S' && *p != 's'){
+            return false;
+        }
+        p = parse_counts(p + 1, &survive);
+        if ((*p == '/' || *p == '_') && (p[1] == 'C' || p[1] == 'c') && isdigit((unsigned char) p[2])){
+            p = parse_states(p + 2, &states);
+        }
+        if (*p != '\0' && *p != '_' && !isspace((unsigned char) *p)){
+            return false;
+        }
+    }else{
+        p = parse_counts(p, &survive);
+        if (*p != '/'){
+            return false;
+        }
+        p = parse_counts(p + 1, &birth);
+        if (*p == '/'){
+            const char* q = parse_states(p + 1, &states);
+            if (q == p + 1){
+                return false;
+            }
+            p = q;
+        }
+        while (isspace((unsigned char) *p)){ p++; }
+        if (*p != '\0'){
+            return false;
+        }
+    }
+
+    if (states < 2 || states > RULE_STATES_MAX){
+        return false;
+    }
+
+    char b_str[10], s_str[10];
+    write_counts(b_str, birth);
+    write_counts(s_str, survive);
+    memset(rule, 0, sizeof(rule_t));
+    rule->states = states;
+    rule->range = 1;
+    rule->birth = birth;
+    rule->survive = survive;
+    if (states > 2){
+        snprintf(rule->name, RULE_NAME_LEN, "B%s/S%s/C%d", b_str, s_str, states);
+    }else{
+        snprintf(rule->name, RULE_NAME_LEN, "B%s/S%s", b_str, s_str);
+    }
+    return true;
+}
+
+// Fills table[state * 9 + count] with the next state, so a step is a single lookup.
+void compile_rule_table(const rule_t* rule, uint8_t* table){
+    for (int n=0; n<9; n++){
+        table[n]     = (rule->birth >> n) & 1;
+        table[9 + n] = (rule->survive >> n) & 1;
+    }
+}
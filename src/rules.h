@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define RULE_NAME_LEN 48
+#define LTL_RANGE_MAX 10
+#define RULE_STATES_MAX 256
+
+
+// Outer-totalistic rule: bit n of birth/survive is set when a cell with n live neighbours
+// is born/survives. Larger-than-Life rules (range > 1) count the (2R+1)^2 box around the
+// cell instead and give birth/survive as count intervals; with range 1 they are compiled
+// into the masks and run like any other rule. Generations rules (states > 2) send a live
+// cell that does not survive through the dying states 2..states-1 back to 0.
+struct rule_t{
+    uint16_t birth;
+    uint16_t survive;
+    uint16_t states;
+    uint8_t range;
+    uint8_t middle;             // The cell counts itself (Larger-than-Life "M1").
+    uint16_t birth_min;
+    uint16_t birth_max;
+    uint16_t survive_min;
+    uint16_t survive_max;
+    char name[RULE_NAME_LEN];
+};
+
+bool parse_rule(const char* text, rule_t* rule);
+void compile_rule_table(const rule_t* rule, uint8_t* table);
@@ -0,0 +1,176 @@
+#include "sim_thread.h"
+
+#include <algorithm>
+#include "c_logger.h"
+
+
+SimThread::SimThread(World& world) :
+        m_world(world), m_quit(false), m_started(false), m_rate(SIM_RATE), m_speed_log2(0),
+        m_sample_gens(0), m_gens_per_s(0), m_back(2), m_front(0), m_middle(1)
+    {
+}
+
+SimThread::~SimThread(){
+        stop();
+}
+
+// Only takes effect before start(); the simulation thread reads the rate unlocked.
+void SimThread::set_rate(double rate){
+        if (!m_started){
+            m_rate = (rate > 0) ? rate : 0;
+        }
+}
+
+// Called from the render thread; takes effect at the next tick.
+void SimThread::change_speed(int delta){
+        int speed = m_speed_log2.load(std::memory_order_relaxed) + delta;
+        speed = std::max(0, std::min(speed, SPEED_LOG2_MAX + 1));
+        m_speed_log2.store(speed, std::memory_order_relaxed);
+        LOG(4, "%s: speed: %d.", __func__, speed);
+}
+
+// Publishes the initial state on the calling thread so the first acquire() has a frame.
+void SimThread::start(){
+        if (m_started){
+            return;
+        }
+        publish();
+        m_quit = false;
+        m_started = true;
+        m_thread = std::thread(&SimThread::loop, this);
+        LOG(4, "%s: rate: %.0f gens/s.", __func__, m_rate);
+}
+
+void SimThread::stop(){
+        if (!m_started){
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake_cv.notify_one();
+        m_thread.join();
+        m_started = false;
+}
+
+void SimThread::post(std::function<void(World&)> command){
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_commands.push_back(std::move(command));
+        }
+        m_wake_cv.notify_one();
+}
+
+// Runs hook on the simulation thread after every generation a tick steps, published or
+// not; frame capture records through it. Only takes effect before start().
+void SimThread::set_generation_hook(std::function<void(World&)> hook){
+        if (!m_started){
+            m_generation_hook = std::move(hook);
+        }
+}
+
+// Takes the newest published snapshot if there is one; otherwise the previous one stays
+// current. Render thread only.
+const world_snapshot& SimThread::acquire(){
+        if (m_middle.load(std::memory_order_acquire) & SNAPSHOT_FRESH){
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & SNAPSHOT_INDEX;
+        }
+        return m_snapshots[m_front];
+}
+
+void SimThread::publish(){
+        world_snapshot& snap = m_snapshots[m_back];
+        m_world.snapshot(snap);
+        int speed = m_speed_log2.load(std::memory_order_relaxed);
+        snap.gens_per_tick = (speed > SPEED_LOG2_MAX) ? 0 : (size_t)1 << speed;
+        snap.gens_per_s = (m_world.get_state() == _RUN) ? m_gens_per_s : 0;
+        m_back = m_middle.exchange(m_back | SNAPSHOT_FRESH, std::memory_order_acq_rel) & SNAPSHOT_INDEX;
+}
+
+// Runs the queued commands in the order they were posted. Returns whether there were any.
+bool SimThread::apply_commands(){
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_batch.swap(m_commands);
+        }
+        for (auto& command : m_batch){
+            command(m_world);
+        }
+        bool applied = !m_batch.empty();
+        m_batch.clear();
+        return applied;
+}
+
+// Steps one tick's worth of generations, stopping early if the run ends, and updates the
+// measured rate.
+void SimThread::tick(){
+        using clock = std::chrono::steady_clock;
+        int speed = m_speed_log2.load(std::memory_order_relaxed);
+        clock::time_point start = clock::now();
+        uint64_t gens = 0;
+        if (speed > SPEED_LOG2_MAX){
+            clock::time_point end = start + std::chrono::milliseconds(SIM_BUDGET_MS);
+            do{
+                m_world.cycle();
+                gens++;
+                if (m_generation_hook){
+                    m_generation_hook(m_world);
+                }
+            }while (m_world.get_state() == _RUN && clock::now() < end);
+        }else{
+            for (size_t i=0; i<((size_t)1 << speed) && m_world.get_state() == _RUN; i++){
+                m_world.cycle();
+                gens++;
+                if (m_generation_hook){
+                    m_generation_hook(m_world);
+                }
+            }
+        }
+
+        if (m_sample_gens == 0){
+            m_sample_start = start;
+        }
+        m_sample_gens += gens;
+        double elapsed = std::chrono::duration<double>(clock::now() - m_sample_start).count();
+        if (elapsed * 1000 >= SPEED_SAMPLE_MS){
+            m_gens_per_s = m_sample_gens / elapsed;
+            m_sample_gens = 0;
+        }
+}
+
+// While running, ticks on a fixed schedule (or back to back at rate 0 and at max speed,
+// where the budget only bounds how long commands and the next snapshot wait); a schedule
+// that falls behind is not caught up in a burst. While idle, sleeps until a command arrives.
+void SimThread::loop(){
+        using clock = std::chrono::steady_clock;
+        const clock::duration period = (m_rate > 0) ? std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / m_rate)) : clock::duration::zero();
+        clock::time_point next = clock::now();
+        bool pending = false;
+        while (true){
+            pending |= apply_commands();
+            clock::time_point now = clock::now();
+            if (m_world.get_state() == _RUN && now >= next){
+                tick();
+                pending = true;
+                next = std::max(next + period, clock::now());
+            }else if (m_world.get_state() != _RUN){
+                m_sample_gens = 0;
+            }
+            bool running = m_world.get_state() == _RUN;
+            if (pending && (!running || !(m_middle.load(std::memory_order_acquire) & SNAPSHOT_FRESH))){
+                publish();
+                pending = false;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_quit){
+                break;
+            }
+            if (!running){
+                m_wake_cv.wait(lock, [this]{ return m_quit || !m_commands.empty(); });
+            }else if (period > clock::duration::zero() && m_speed_log2.load(std::memory_order_relaxed) <= SPEED_LOG2_MAX){
+                m_wake_cv.wait_until(lock, next, [this]{ return m_quit || !m_commands.empty(); });
+            }
+        }
+}
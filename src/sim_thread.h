@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "world.h"
+
+#define SIM_RATE 60             // Ticks per second while running; 0 ticks as fast as possible.
+#define SPEED_LOG2_MAX 10       // +/- doubles the generations per tick up to 2^10; one step further is max speed.
+#define SIM_BUDGET_MS 12        // Time a max-speed tick spends stepping before the result is published.
+#define SPEED_SAMPLE_MS 500     // Window for the measured generations per second.
+#define SNAPSHOT_INDEX 3
+#define SNAPSHOT_FRESH 4        // Set on m_middle when it holds a snapshot the renderer has not taken.
+
+
+// Runs the World on its own thread so stepping is not tied to the frame rate. Each tick
+// steps 2^speed generations, or at max speed as many as fit in SIM_BUDGET_MS, and only
+// the last one is published. Edits from the render thread are posted as commands and
+// applied between ticks. Completed generations go into a triple buffer: the simulation thread fills the back slot and swaps
+// it with the middle one, and acquire() swaps the middle slot to the front. Neither side
+// ever waits for the other. A snapshot is only copied once the renderer has taken the
+// previous one, or when the simulation goes idle, so running flat out costs one copy per
+// rendered frame rather than one per generation.
+class SimThread{
+    private:
+        World& m_world;
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_wake_cv;
+        std::vector<std::function<void(World&)>> m_commands;
+        std::vector<std::function<void(World&)>> m_batch;
+        std::function<void(World&)> m_generation_hook;
+        bool m_quit;
+        bool m_started;
+        double m_rate;
+        std::atomic<int> m_speed_log2;  // SPEED_LOG2_MAX + 1 is max speed.
+        uint64_t m_sample_gens;
+        std::chrono::steady_clock::time_point m_sample_start;
+        double m_gens_per_s;
+        world_snapshot m_snapshots[3];
+        size_t m_back;                  // Owned by the simulation thread.
+        size_t m_front;                 // Owned by the render thread.
+        std::atomic<size_t> m_middle;
+
+        void loop();
+        bool apply_commands();
+        void tick();
+        void publish();
+
+    public:
+        SimThread(World& world);
+        ~SimThread();
+        void set_rate(double rate);
+        void change_speed(int delta);
+        void start();
+        void stop();
+        void post(std::function<void(World&)> command);
+        void set_generation_hook(std::function<void(World&)> hook);
+        const world_snapshot& acquire();
+};
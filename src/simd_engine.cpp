@@ -0,0 +1,175 @@
+#include "simd_engine.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+const char simd_isa_names[3][8] = {"scalar", "sse2", "avx2"};
+
+
+// lut[0..15] holds the birth result per neighbour count, lut[16..31] the survive result.
+static inline uint8_t next_value(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, size_t x, size_t columns, const uint8_t* lut){
+    size_t xl = (x == 0) ? columns - 1 : x - 1;
+    size_t xr = (x + 1 == columns) ? 0 : x + 1;
+    uint8_t count = up[xl] + up[x] + up[xr] + mid[xl] + mid[xr] + dn[xl] + dn[x] + dn[xr];
+    return lut[(mid[x] << 4) + count];
+}
+
+// Kernels fill out[x0..x1). Columns 0 and columns-1 wrap around and always take next_value().
+static void row_kernel_scalar(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, size_t columns, size_t x0, size_t x1, const uint8_t* lut){
+    size_t x = x0;
+    if (x == 0){
+        out[0] = next_value(up, mid, dn, 0, columns, lut);
+        x = 1;
+    }
+    size_t end = (x1 < columns - 1) ? x1 : columns - 1;
+    for (; x<end; x++){
+        uint8_t count = up[x-1] + up[x] + up[x+1] + mid[x-1] + mid[x+1] + dn[x-1] + dn[x] + dn[x+1];
+        out[x] = lut[(mid[x] << 4) + count];
+    }
+    for (; x<x1; x++){
+        out[x] = next_value(up, mid, dn, x, columns, lut);
+    }
+}
+
+#if SIMD_X86
+
+struct sse2_lut{
+    __m128i born_sel[9];
+    __m128i kept_sel[9];
+};
+
+static inline void sse2_block(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, size_t x, const sse2_lut* t){
+    __m128i count = _mm_add_epi8(
+        _mm_add_epi8(_mm_add_epi8(_mm_loadu_si128((const __m128i*)(up + x - 1)), _mm_loadu_si128((const __m128i*)(up + x))),
+                     _mm_add_epi8(_mm_loadu_si128((const __m128i*)(up + x + 1)), _mm_loadu_si128((const __m128i*)(mid + x - 1)))),
+        _mm_add_epi8(_mm_add_epi8(_mm_loadu_si128((const __m128i*)(mid + x + 1)), _mm_loadu_si128((const __m128i*)(dn + x - 1))),
+                     _mm_add_epi8(_mm_loadu_si128((const __m128i*)(dn + x)), _mm_loadu_si128((const __m128i*)(dn + x + 1)))));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i born = zero, kept = zero;
+    for (int n=0; n<9; n++){
+        __m128i eq = _mm_cmpeq_epi8(count, _mm_set1_epi8(n));
+        born = _mm_or_si128(born, _mm_and_si128(eq, t->born_sel[n]));
+        kept = _mm_or_si128(kept, _mm_and_si128(eq, t->kept_sel[n]));
+    }
+    __m128i alive = _mm_sub_epi8(zero, _mm_loadu_si128((const __m128i*)(mid + x)));
+    __m128i next = _mm_or_si128(_mm_andnot_si128(alive, born), _mm_and_si128(alive, kept));
+    _mm_storeu_si128((__m128i*)(out + x), _mm_and_si128(next, _mm_set1_epi8(1)));
+}
+
+// A span that does not end on a block boundary finishes with one block overlapping
+// its own earlier cells; recomputing a cell writes the same value.
+static void row_kernel_sse2(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, size_t columns, size_t x0, size_t x1, const uint8_t* lut){
+    sse2_lut t;
+    for (int n=0; n<9; n++){
+        t.born_sel[n] = _mm_set1_epi8(lut[n] ? (char)0xFF : 0);
+        t.kept_sel[n] = _mm_set1_epi8(lut[16 + n] ? (char)0xFF : 0);
+    }
+    size_t x = x0;
+    if (x == 0){
+        out[0] = next_value(up, mid, dn, 0, columns, lut);
+        x = 1;
+    }
+    size_t start = x;
+    size_t end = (x1 < columns - 1) ? x1 : columns - 1;
+    for (; x + 16 <= end; x += 16){
+        sse2_block(up, mid, dn, out, x, &t);
+    }
+    if (x < end && end >= start + 16){
+        sse2_block(up, mid, dn, out, end - 16, &t);
+        x = end;
+    }
+    for (; x<x1; x++){
+        out[x] = next_value(up, mid, dn, x, columns, lut);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void avx2_block(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, size_t x, __m256i born_lut, __m256i kept_lut){
+    __m256i count = _mm256_add_epi8(
+        _mm256_add_epi8(_mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(up + x - 1)), _mm256_loadu_si256((const __m256i*)(up + x))),
+                        _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(up + x + 1)), _mm256_loadu_si256((const __m256i*)(mid + x - 1)))),
+        _mm256_add_epi8(_mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(mid + x + 1)), _mm256_loadu_si256((const __m256i*)(dn + x - 1))),
+                        _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(dn + x)), _mm256_loadu_si256((const __m256i*)(dn + x + 1)))));
+    __m256i born = _mm256_shuffle_epi8(born_lut, count);
+    __m256i kept = _mm256_shuffle_epi8(kept_lut, count);
+    __m256i alive = _mm256_sub_epi8(_mm256_setzero_si256(), _mm256_loadu_si256((const __m256i*)(mid + x)));
+    _mm256_storeu_si256((__m256i*)(out + x), _mm256_blendv_epi8(born, kept, alive));
+}
+
+__attribute__((target("avx2")))
+static void row_kernel_avx2(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, size_t columns, size_t x0, size_t x1, const uint8_t* lut){
+    const __m256i born_lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)lut));
+    const __m256i kept_lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(lut + 16)));
+    size_t x = x0;
+    if (x == 0){
+        out[0] = next_value(up, mid, dn, 0, columns, lut);
+        x = 1;
+    }
+    size_t start = x;
+    size_t end = (x1 < columns - 1) ? x1 : columns - 1;
+    for (; x + 32 <= end; x += 32){
+        avx2_block(up, mid, dn, out, x, born_lut, kept_lut);
+    }
+    if (x < end && end >= start + 32){
+        avx2_block(up, mid, dn, out, end - 32, born_lut, kept_lut);
+        x = end;
+    }
+    for (; x<x1; x++){
+        out[x] = next_value(up, mid, dn, x, columns, lut);
+    }
+}
+
+#endif
+
+
+SimdEngine::SimdEngine(){
+        int isa = _ISA_SCALAR;
+#if SIMD_X86
+        __builtin_cpu_init();
+        isa = _ISA_SSE2;
+        if (__builtin_cpu_supports("avx2")){
+            isa = _ISA_AVX2;
+        }
+#endif
+        set_isa(isa);
+        set_rule(0, 0);
+}
+
+int SimdEngine::get_isa(){ return m_isa; }
+const char* SimdEngine::get_isa_name(){ return simd_isa_names[m_isa]; }
+
+void SimdEngine::set_isa(int isa){
+        m_isa = isa;
+        switch (isa){
+#if SIMD_X86
+            case _ISA_AVX2:
+                m_row_kernel = &row_kernel_avx2;
+                break;
+            case _ISA_SSE2:
+                m_row_kernel = &row_kernel_sse2;
+                break;
+#endif
+            default:
+                m_isa = _ISA_SCALAR;
+                m_row_kernel = &row_kernel_scalar;
+                break;
+        }
+}
+
+void SimdEngine::set_rule(uint16_t birth, uint16_t survive){
+        for (int n=0; n<16; n++){
+            m_lut[n]      = (n < 9) ? (birth >> n) & 1 : 0;
+            m_lut[16 + n] = (n < 9) ? (survive >> n) & 1 : 0;
+        }
+}
+
+void SimdEngine::step_span(const uint8_t* cells, uint8_t* next, size_t columns, size_t rows, size_t y, size_t x0, size_t x1){
+        const uint8_t* up  = cells + (((y + rows - 1) % rows) * columns);
+        const uint8_t* mid = cells + (y * columns);
+        const uint8_t* dn  = cells + (((y + 1) % rows) * columns);
+        (*m_row_kernel)(up, mid, dn, next + (y * columns), columns, x0, x1, m_lut);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+enum simd_isas{
+    _ISA_SCALAR,
+    _ISA_SSE2,
+    _ISA_AVX2
+};
+
+extern const char simd_isa_names[3][8];
+
+typedef void (*simd_row_kernel)(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, size_t columns, size_t x0, size_t x1, const uint8_t* lut);
+
+
+// Vectorised byte-grid engine: sums the 8 neighbours of 16 (SSE2) or 32 (AVX2) cells
+// per instruction straight from the uint8_t buffers. The ISA is picked once via CPUID.
+class SimdEngine{
+    private:
+        int m_isa;
+        simd_row_kernel m_row_kernel;
+        uint8_t m_lut[32];
+
+    public:
+        SimdEngine();
+        int get_isa();
+        const char* get_isa_name();
+        void set_isa(int isa);
+        void set_rule(uint16_t birth, uint16_t survive);
+        void step_span(const uint8_t* cells, uint8_t* next, size_t columns, size_t rows, size_t y, size_t x0, size_t x1);
+};
@@ -0,0 +1,227 @@
+#include "sparse_world.h"
+
+#include <algorithm>
+#include <string.h>
+#include "bit_engine.h"
+#include "tile_map.h"
+
+
+static inline uint64_t chunk_key(int64_t cx, int64_t cy){
+    return ((uint64_t)(uint32_t)(int32_t)cx << 32) | (uint32_t)(int32_t)cy;
+}
+
+static inline int64_t chunk_key_x(uint64_t key){ return (int32_t)(key >> 32); }
+static inline int64_t chunk_key_y(uint64_t key){ return (int32_t)(key & 0xFFFFFFFF); }
+
+// Floor division by CHUNK_SIZE, also for negative coordinates.
+static inline int64_t chunk_of(int64_t v){ return v >> 6; }
+
+// Zobrist key of one chunk row, like the 8-cell groups of the torus.
+static inline uint64_t row_key(uint64_t key, int y, uint64_t row){
+    return group_key((key * CHUNK_SIZE) + y, row);
+}
+
+static inline bool chunk_empty(const sparse_chunk* c){
+    for (int y=0; y<CHUNK_SIZE; y++){
+        if (c->rows[y]){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void SparseWorld::clear(){
+        m_chunks.clear();
+        m_stats = {};
+}
+
+const sparse_chunk* SparseWorld::find(int64_t cx, int64_t cy) const {
+        auto it = m_chunks.find(chunk_key(cx, cy));
+        return (it == m_chunks.end()) ? nullptr : &it->second;
+}
+
+void SparseWorld::load(const uint8_t* cells, size_t columns, size_t rows, int64_t x0, int64_t y0){
+        for (size_t y=0; y<rows; y++){
+            for (size_t x=0; x<columns; x++){
+                if (cells[(y * columns) + x]){
+                    set_cell(x0 + x, y0 + y, 1);
+                }
+            }
+        }
+}
+
+void SparseWorld::set_cell(int64_t x, int64_t y, uint8_t value){
+        uint64_t key = chunk_key(chunk_of(x), chunk_of(y));
+        uint64_t bit = (uint64_t)1 << (x & (CHUNK_SIZE - 1));
+        auto it = m_chunks.find(key);
+        if (it == m_chunks.end()){
+            if (!value){
+                return;
+            }
+            sparse_chunk chunk;
+            memset(&chunk, 0, sizeof(chunk));
+            it = m_chunks.emplace(key, chunk).first;
+        }
+        uint64_t& row = it->second.rows[y & (CHUNK_SIZE - 1)];
+        row = value ? (row | bit) : (row & ~bit);
+        if (!value && chunk_empty(&it->second)){
+            m_chunks.erase(it);
+        }
+}
+
+// Sets n live cells from (x, y) to the right, a whole chunk row word at a time.
+void SparseWorld::set_run(int64_t x, int64_t y, int64_t n){
+        while (n > 0){
+            int64_t bit = x & (CHUNK_SIZE - 1);
+            int64_t len = std::min<int64_t>(n, CHUNK_SIZE - bit);
+            uint64_t mask = (len == CHUNK_SIZE) ? ~(uint64_t)0 : (((uint64_t)1 << len) - 1) << bit;
+            uint64_t key = chunk_key(chunk_of(x), chunk_of(y));
+            auto it = m_chunks.find(key);
+            if (it == m_chunks.end()){
+                sparse_chunk chunk;
+                memset(&chunk, 0, sizeof(chunk));
+                it = m_chunks.emplace(key, chunk).first;
+            }
+            it->second.rows[y & (CHUNK_SIZE - 1)] |= mask;
+            x += len;
+            n -= len;
+        }
+}
+
+// Same carry-save kernel as BitEngine; the 3x3 block of neighbouring chunks supplies the
+// rows above/below and the bits west/east of the chunk. Missing chunks read as empty.
+void SparseWorld::step_chunk(int64_t cx, int64_t cy, sparse_chunk* out, const uint8_t* counts, size_t count_n, uint16_t birth, uint16_t survive) const {
+        const sparse_chunk* block[3][3];
+        for (int dy=0; dy<3; dy++){
+            for (int dx=0; dx<3; dx++){
+                block[dy][dx] = find(cx + dx - 1, cy + dy - 1);
+            }
+        }
+        auto row = [&](int gx, int ry) -> uint64_t {
+            int gy = (ry < 0) ? 0 : ((ry >= CHUNK_SIZE) ? 2 : 1);
+            const sparse_chunk* c = block[gy][gx];
+            return c ? c->rows[(ry + CHUNK_SIZE) & (CHUNK_SIZE - 1)] : 0;
+        };
+        for (int y=0; y<CHUNK_SIZE; y++){
+            uint64_t r[3][3];
+            for (int k=0; k<3; k++){
+                uint64_t w = row(0, y + k - 1), c = row(1, y + k - 1), e = row(2, y + k - 1);
+                r[k][0] = (c << 1) | (w >> 63);
+                r[k][1] = c;
+                r[k][2] = (c >> 1) | (e << 63);
+            }
+            out->rows[y] = life_word(r[0][0], r[0][1], r[0][2], r[1][0], r[1][1], r[1][2], r[2][0], r[2][1], r[2][2],
+                                     counts, count_n, birth, survive);
+        }
+}
+
+// Candidates are all live chunks plus any neighbour that live cells on an edge or corner
+// can reach. Results are computed in parallel and only non-empty chunks are kept. Each
+// job also counts its chunks' population, births and deaths against the old chunk and
+// hashes their rows, so the totals cost nothing beyond the live area.
+void SparseWorld::step(uint16_t birth, uint16_t survive, ThreadPool& pool){
+        m_candidates.clear();
+        for (const auto& kv : m_chunks){
+            int64_t cx = chunk_key_x(kv.first), cy = chunk_key_y(kv.first);
+            const uint64_t* r = kv.second.rows;
+            uint64_t west = 0, east = 0;
+            for (int y=0; y<CHUNK_SIZE; y++){
+                west |= r[y] & 1;
+                east |= r[y] >> 63;
+            }
+            uint64_t north = r[0], south = r[CHUNK_SIZE - 1];
+            m_candidates.push_back(kv.first);
+            if (north){ m_candidates.push_back(chunk_key(cx, cy - 1)); }
+            if (south){ m_candidates.push_back(chunk_key(cx, cy + 1)); }
+            if (west){ m_candidates.push_back(chunk_key(cx - 1, cy)); }
+            if (east){ m_candidates.push_back(chunk_key(cx + 1, cy)); }
+            if (north & 1){ m_candidates.push_back(chunk_key(cx - 1, cy - 1)); }
+            if (north >> 63){ m_candidates.push_back(chunk_key(cx + 1, cy - 1)); }
+            if (south & 1){ m_candidates.push_back(chunk_key(cx - 1, cy + 1)); }
+            if (south >> 63){ m_candidates.push_back(chunk_key(cx + 1, cy + 1)); }
+        }
+        std::sort(m_candidates.begin(), m_candidates.end());
+        m_candidates.erase(std::unique(m_candidates.begin(), m_candidates.end()), m_candidates.end());
+
+        uint8_t counts[9];
+        size_t count_n = rule_counts(birth, survive, counts);
+        size_t n = m_candidates.size();
+        m_results.resize(n);
+        size_t jobs = std::min(n, pool.size() * 4);
+        m_job_stats.assign(jobs, sparse_stats{});
+        pool.run(jobs, [&](size_t j){
+            sparse_stats& stats = m_job_stats[j];
+            for (size_t i=(n * j) / jobs; i<(n * (j + 1)) / jobs; i++){
+                int64_t cx = chunk_key_x(m_candidates[i]), cy = chunk_key_y(m_candidates[i]);
+                step_chunk(cx, cy, &m_results[i], counts, count_n, birth, survive);
+                const sparse_chunk* old = find(cx, cy);
+                for (int y=0; y<CHUNK_SIZE; y++){
+                    uint64_t now = m_results[i].rows[y], was = old ? old->rows[y] : 0;
+                    stats.population += __builtin_popcountll(now);
+                    stats.births += __builtin_popcountll(now & ~was);
+                    stats.deaths += __builtin_popcountll(was & ~now);
+                    stats.hash ^= row_key(m_candidates[i], y, now);
+                }
+            }
+        });
+        m_stats = {};
+        for (const sparse_stats& stats : m_job_stats){
+            m_stats.population += stats.population;
+            m_stats.births += stats.births;
+            m_stats.deaths += stats.deaths;
+            m_stats.hash ^= stats.hash;
+        }
+
+        m_chunks.clear();
+        for (size_t i=0; i<n; i++){
+            if (!chunk_empty(&m_results[i])){
+                m_chunks.emplace(m_candidates[i], m_results[i]);
+            }
+        }
+}
+
+void SparseWorld::store(uint8_t* cells, size_t columns, size_t rows, int64_t x0, int64_t y0){
+        memset(cells, 0, columns * rows);
+        int64_t x1 = x0 + columns, y1 = y0 + rows;
+        for (int64_t cy=chunk_of(y0); cy<=chunk_of(y1 - 1); cy++){
+            for (int64_t cx=chunk_of(x0); cx<=chunk_of(x1 - 1); cx++){
+                const sparse_chunk* c = find(cx, cy);
+                if (!c){
+                    continue;
+                }
+                int64_t gy0 = std::max(y0, cy * CHUNK_SIZE), gy1 = std::min(y1, (cy + 1) * CHUNK_SIZE);
+                int64_t gx0 = std::max(x0, cx * CHUNK_SIZE), gx1 = std::min(x1, (cx + 1) * CHUNK_SIZE);
+                for (int64_t gy=gy0; gy<gy1; gy++){
+                    uint64_t w = c->rows[gy - (cy * CHUNK_SIZE)];
+                    if (!w){
+                        continue;
+                    }
+                    uint8_t* dst = cells + ((gy - y0) * columns);
+                    for (int64_t gx=gx0; gx<gx1; gx++){
+                        dst[gx - x0] = (w >> (gx - (cx * CHUNK_SIZE))) & 1;
+                    }
+                }
+            }
+        }
+}
+
+size_t SparseWorld::get_chunk_count(){
+        return m_chunks.size();
+}
+
+// Recounts the population and hash after edits; births and deaths are those of step().
+void SparseWorld::count(){
+        m_stats.population = 0;
+        m_stats.hash = 0;
+        for (const auto& kv : m_chunks){
+            for (int y=0; y<CHUNK_SIZE; y++){
+                m_stats.population += __builtin_popcountll(kv.second.rows[y]);
+                m_stats.hash ^= row_key(kv.first, y, kv.second.rows[y]);
+            }
+        }
+}
+
+const sparse_stats& SparseWorld::get_stats(){
+        return m_stats;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "thread_pool.h"
+
+#define CHUNK_SIZE 64
+
+
+// 64x64 cells, one uint64_t per row (bit b = column b), same layout as BitEngine words.
+struct sparse_chunk{
+    uint64_t rows[CHUNK_SIZE];
+};
+
+
+// Totals of the plane, from the chunks step() wrote or from count().
+struct sparse_stats{
+    uint64_t population;
+    uint64_t births;
+    uint64_t deaths;
+    uint64_t hash;          // XOR of group_key() over the non-empty chunk rows.
+};
+
+
+// Unbounded world: a hash map of chunks keyed by chunk coordinate. Chunks are created when
+// activity reaches their edge and dropped as soon as they are empty, so memory and step
+// time follow the live area rather than the window size.
+class SparseWorld{
+    private:
+        std::unordered_map<uint64_t, sparse_chunk> m_chunks;
+        std::vector<uint64_t> m_candidates;
+        std::vector<sparse_chunk> m_results;
+        std::vector<sparse_stats> m_job_stats;
+        sparse_stats m_stats;
+
+        const sparse_chunk* find(int64_t cx, int64_t cy) const;
+        void step_chunk(int64_t cx, int64_t cy, sparse_chunk* out, const uint8_t* counts, size_t count_n, uint16_t birth, uint16_t survive) const;
+
+    public:
+        void clear();
+        void load(const uint8_t* cells, size_t columns, size_t rows, int64_t x0, int64_t y0);
+        void set_cell(int64_t x, int64_t y, uint8_t value);
+        void set_run(int64_t x, int64_t y, int64_t n);
+        void step(uint16_t birth, uint16_t survive, ThreadPool& pool);
+        void store(uint8_t* cells, size_t columns, size_t rows, int64_t x0, int64_t y0);
+        size_t get_chunk_count();
+        void count();
+        const sparse_stats& get_stats();
+};
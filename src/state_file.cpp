@@ -0,0 +1,211 @@
+#include "state_file.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "c_logger.h"
+
+
+static inline uint64_t align_up(uint64_t v){
+    return (v + STATE_ALIGN - 1) & ~(uint64_t)(STATE_ALIGN - 1);
+}
+
+// Gathers eight cell bytes into one byte, cell 0 in bit 0 (little-endian hosts). Only
+// live cells (state 1) set their bit: bytes equal to 1 are found with a zero-byte test.
+static inline uint8_t pack8(const uint8_t* src){
+    uint64_t x;
+    memcpy(&x, src, 8);
+    x ^= 0x0101010101010101ULL;
+    x = ~(((x & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | x) >> 7;
+    x &= 0x0101010101010101ULL;
+    return (x * 0x0102040810204080ULL) >> 56;
+}
+
+// Spreads the eight bits of v into eight 0/1 cell bytes.
+static inline void unpack8(uint8_t v, uint8_t* dst){
+    uint64_t m = (v * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+    uint64_t x = ((m + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+    memcpy(dst, &x, 8);
+}
+
+
+size_t state_row_words(size_t columns){
+    return (columns + 63) / 64;
+}
+
+void pack_cells(const uint8_t* cells, size_t columns, size_t rows, uint64_t* words){
+    size_t row_words = state_row_words(columns);
+    for (size_t y=0; y<rows; y++){
+        const uint8_t* src = cells + (y * columns);
+        uint64_t* dst = words + (y * row_words);
+        memset(dst, 0, row_words * sizeof(uint64_t));
+        size_t x = 0;
+        for (; x + 8 <= columns; x += 8){
+            dst[x / 64] |= (uint64_t)pack8(src + x) << (x % 64);
+        }
+        for (; x<columns; x++){
+            dst[x / 64] |= (uint64_t)(src[x] == 1) << (x % 64);
+        }
+    }
+}
+
+void unpack_cells(const uint64_t* words, size_t columns, size_t rows, uint8_t* cells){
+    size_t row_words = state_row_words(columns);
+    for (size_t y=0; y<rows; y++){
+        const uint64_t* src = words + (y * row_words);
+        uint8_t* dst = cells + (y * columns);
+        size_t x = 0;
+        for (; x + 8 <= columns; x += 8){
+            unpack8((src[x / 64] >> (x % 64)) & 0xFF, dst + x);
+        }
+        for (; x<columns; x++){
+            dst[x] = (src[x / 64] >> (x % 64)) & 1;
+        }
+    }
+}
+
+// Fills in the magic, version and section offsets of header and writes the file. births
+// may be null, in which case the file carries no ages; with states set the cell bytes are
+// also written as they are, for rules with dying states.
+bool write_state_file(const char* path, state_header* header, const uint8_t* cells, const uint32_t* births, bool states){
+    size_t row_words = state_row_words(header->columns);
+    uint64_t cells_size = row_words * header->rows * sizeof(uint64_t);
+    uint64_t births_size = header->columns * header->rows * sizeof(uint32_t);
+    uint64_t states_size = header->columns * header->rows;
+    memcpy(header->magic, STATE_MAGIC, sizeof(header->magic));
+    header->version = STATE_VERSION;
+    header->header_size = sizeof(state_header);
+    header->flags = (births ? STATE_AGES : 0) | (states ? STATE_STATES : 0);
+    header->cells_offset = align_up(sizeof(state_header));
+    header->file_size = header->cells_offset + cells_size;
+    header->births_offset = births ? align_up(header->file_size) : 0;
+    header->file_size = births ? header->births_offset + births_size : header->file_size;
+    header->states_offset = states ? align_up(header->file_size) : 0;
+    header->file_size = states ? header->states_offset + states_size : header->file_size;
+
+    FILE* file = fopen(path, "wb");
+    if (!file){
+        LOG(2, "%s: cannot write '%s'.", __func__, path);
+        return false;
+    }
+    static const uint8_t zeros[STATE_ALIGN] = {};
+    bool ok = fwrite(header, sizeof(state_header), 1, file) == 1;
+    ok = ok && fwrite(zeros, 1, header->cells_offset - sizeof(state_header), file) == header->cells_offset - sizeof(state_header);
+
+    // Packed a block of rows at a time so the buffer stays small for any grid size.
+    const size_t block = 256;
+    std::vector<uint64_t> words(row_words * block);
+    for (size_t y=0; ok && y<header->rows; y+=block){
+        size_t n = std::min(block, (size_t)header->rows - y);
+        pack_cells(cells + (y * header->columns), header->columns, n, words.data());
+        ok = fwrite(words.data(), sizeof(uint64_t), row_words * n, file) == row_words * n;
+    }
+    uint64_t written = header->cells_offset + cells_size;
+    if (ok && births){
+        uint64_t pad = header->births_offset - written;
+        ok = fwrite(zeros, 1, pad, file) == pad;
+        ok = ok && fwrite(births, sizeof(uint32_t), header->columns * header->rows, file) == header->columns * header->rows;
+        written = header->births_offset + births_size;
+    }
+    if (ok && states){
+        uint64_t pad = header->states_offset - written;
+        ok = fwrite(zeros, 1, pad, file) == pad;
+        ok = ok && fwrite(cells, 1, states_size, file) == states_size;
+    }
+    ok = (fclose(file) == 0) && ok;
+    LOG(ok ? 4 : 2, "%s: '%s': %ldx%ld, generation: %ld, %ld bytes.", __func__, path, header->columns, header->rows, header->generation, header->file_size);
+    return ok;
+}
+
+
+StateFile::StateFile() :
+        m_fd(-1), m_data(nullptr), m_size(0)
+    {
+}
+
+StateFile::~StateFile(){
+        close();
+}
+
+void StateFile::close(){
+        if (m_data){
+            munmap((void*) m_data, m_size);
+            m_data = nullptr;
+        }
+        if (m_fd >= 0){
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        m_size = 0;
+}
+
+// Rejects files with another magic or version, or whose sections do not fit the file.
+bool StateFile::open(const char* path){
+        close();
+        m_fd = ::open(path, O_RDONLY);
+        if (m_fd < 0){
+            LOG(2, "%s: cannot open '%s'.", __func__, path);
+            return false;
+        }
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || (size_t) st.st_size < sizeof(state_header)){
+            LOG(2, "%s: '%s' is too short.", __func__, path);
+            close();
+            return false;
+        }
+        m_size = st.st_size;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, m_fd, 0);
+        if (data == MAP_FAILED){
+            LOG(2, "%s: cannot map '%s'.", __func__, path);
+            close();
+            return false;
+        }
+        m_data = (const uint8_t*) data;
+
+        const state_header* h = get_header();
+        uint64_t cells_size = state_row_words(h->columns) * h->rows * sizeof(uint64_t);
+        uint64_t births_size = h->columns * h->rows * sizeof(uint32_t);
+        uint64_t states_size = h->columns * h->rows;
+        const char* error = nullptr;
+        if (memcmp(h->magic, STATE_MAGIC, sizeof(h->magic)) != 0){
+            error = "not a state file";
+        }else if (h->version != STATE_VERSION || h->header_size < sizeof(state_header)){
+            error = "unsupported version";
+        }else if (h->file_size != m_size || h->cells_offset + cells_size > m_size
+                  || ((h->flags & STATE_AGES) && h->births_offset + births_size > m_size)
+                  || ((h->flags & STATE_STATES) && h->states_offset + states_size > m_size)
+                  || (h->cells_offset % STATE_ALIGN) || (h->births_offset % STATE_ALIGN) || (h->states_offset % STATE_ALIGN)){
+            error = "truncated or corrupt";
+        }
+        if (error){
+            LOG(2, "%s: '%s': %s.", __func__, path, error);
+            close();
+            return false;
+        }
+        return true;
+}
+
+const state_header* StateFile::get_header(){
+        return (const state_header*) m_data;
+}
+
+const uint64_t* StateFile::get_words(){
+        return (const uint64_t*)(m_data + get_header()->cells_offset);
+}
+
+// Null when the file carries no ages.
+const uint32_t* StateFile::get_births(){
+        const state_header* h = get_header();
+        return (h->flags & STATE_AGES) ? (const uint32_t*)(m_data + h->births_offset) : nullptr;
+}
+
+// Null unless the file was saved under a rule with dying states.
+const uint8_t* StateFile::get_states(){
+        const state_header* h = get_header();
+        return (h->flags & STATE_STATES) ? m_data + h->states_offset : nullptr;
+}
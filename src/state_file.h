@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "rules.h"
+
+#define STATE_MAGIC "GOLSTATE"
+#define STATE_VERSION 3         // 2: 48-byte rule names (Larger-than-Life); 3: cell states.
+#define STATE_ALIGN 64          // Sections start on a cache line so they can be used in place.
+#define STATE_AGES 1            // Flag: the birth stamps section is present.
+#define STATE_STATES 2          // Flag: the cell states section is present.
+#define STATE_PATH "world.gol"
+
+
+// Fixed-size header at the start of a state file. Sections follow at the recorded offsets:
+// the live cells as bit-packed rows of (columns + 63) / 64 words in BitEngine layout, then
+// one uint32_t birth stamp per cell (the low 32 bits of its birth generation), then for
+// Generations rules one state byte per cell.
+// All values are in host byte order.
+struct state_header{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;       // Lets later versions append fields.
+    uint64_t file_size;
+    uint64_t columns;
+    uint64_t rows;
+    uint64_t generation;
+    uint64_t cells_offset;
+    uint64_t births_offset;     // 0 unless STATE_AGES is set.
+    uint64_t states_offset;     // 0 unless STATE_STATES is set.
+    uint32_t flags;
+    uint16_t birth;
+    uint16_t survive;
+    uint8_t mode_ix;
+    uint8_t reserved[7];
+    char rule_name[RULE_NAME_LEN];
+};
+
+
+// Maps a state file read-only and checks the header; the sections are then read in place.
+class StateFile{
+    private:
+        int m_fd;
+        const uint8_t* m_data;
+        size_t m_size;
+
+    public:
+        StateFile();
+        ~StateFile();
+        bool open(const char* path);
+        void close();
+        const state_header* get_header();
+        const uint64_t* get_words();
+        const uint32_t* get_births();
+        const uint8_t* get_states();
+};
+
+size_t state_row_words(size_t columns);
+void pack_cells(const uint8_t* cells, size_t columns, size_t rows, uint64_t* words);
+void unpack_cells(const uint64_t* words, size_t columns, size_t rows, uint8_t* cells);
+bool write_state_file(const char* path, state_header* header, const uint8_t* cells, const uint32_t* births, bool states);
@@ -0,0 +1,368 @@
+// Headless rule-space sweep: runs every combination of rule, initial density, seed and
+// grid size for up to N generations, spread over all cores, and writes one CSV row per
+// run. With --ensemble the seeds of one rule, density and size are stepped together on
+// an EnsembleEngine. Built by 'make sweep' with -DRAYLIB_ENABLED=0.
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include "../ensemble_engine.h"
+#include "../world.h"
+
+#define SWEEP_GENS 1000
+#define SWEEP_SEEDS 4
+#define SWEEP_SAMPLE 10         // Generations between population curve samples.
+#define SWEEP_DIGITS 10         // Default densities: the random-fill digits 0-9, digit / 11.
+#define SWEEP_ENSEMBLE 0        // Worlds per ensemble job; 0 steps every run on its own World.
+
+struct sweep_size{
+    size_t columns;
+    size_t rows;
+};
+
+// One point of the cross product. rule is a rule string, or empty to use mode.
+struct sweep_run{
+    std::string rule;
+    int mode;
+    double density;
+    uint64_t seed;
+    sweep_size size;
+};
+
+struct sweep_result{
+    char rule[RULE_NAME_LEN];
+    uint64_t generations;
+    size_t population;
+    int64_t stable_generation;      // First generation of the repeating cycle, -1 if none was found.
+    size_t period;
+    double seconds;
+    std::vector<size_t> curve;      // Population every SWEEP_SAMPLE generations, from generation 0.
+    bool ok;
+    bool done;
+};
+
+// A job: count consecutive runs from first, stepped together when they form an ensemble.
+struct sweep_batch{
+    size_t first;
+    size_t count;
+};
+
+
+void print_usage(const char* name){
+    fprintf(stderr, "Usage: %s [--gens N] [--modes 0,1,...] [--rules \"B3/S23;B36/S23\"] [--densities 0.1,0.3] [--seeds N] [--seed N] [--sizes 256x256,512x512] [--jobs N] [--ensemble N] [--sample N] [--out FILE] [--curves FILE]\n", name);
+}
+
+// Calls item for every delimiter-separated field of list.
+template<typename F>
+bool for_each_field(const char* list, char delimiter, F item){
+    std::string text(list);
+    size_t start = 0;
+    while (start <= text.size()){
+        size_t end = text.find(delimiter, start);
+        end = (end == std::string::npos) ? text.size() : end;
+        if (end > start && !item(text.substr(start, end - start))){
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+// This thread's World set up for run, or null when its rule or grid size is invalid. A
+// World is kept per worker and resized between runs, since refilling it from the seed
+// resets everything a run leaves behind.
+World* sweep_world(const sweep_run& run){
+    thread_local std::unique_ptr<World> world;
+    if (!world){
+        world.reset(new World(run.size.rows + HUD_H, run.size.columns, 1, run.size.columns, run.size.rows));
+        world->set_threads(1);
+        world->set_ages_enabled(false);
+    }
+    bool ok = (world->get_columns() == run.size.columns && world->get_rows() == run.size.rows)
+              || world->resize(run.size.columns, run.size.rows, 1, false);
+    if (ok && run.rule.empty()){
+        world->select_game_mode(run.mode);
+    }else if (ok){
+        ok = world->set_rule_string(run.rule.c_str());
+    }
+    return ok ? world.get() : nullptr;
+}
+
+// Steps one run on this thread's World until it repeats or the generation budget is spent.
+void sweep_one(const sweep_run& run, int gens, int sample, sweep_result& result){
+    World* world = sweep_world(run);
+    result.ok = world != nullptr;
+    if (!result.ok){
+        return;
+    }
+    snprintf(result.rule, RULE_NAME_LEN, "%s", world->get_rule_name());
+    world->set_seed(run.seed);
+    world->setup_cells(run.density);
+
+    auto t0 = std::chrono::steady_clock::now();
+    result.curve.clear();
+    result.curve.push_back(world->get_stats().population);
+    result.stable_generation = -1;
+    result.period = 0;
+    const world_stats& stats = world->get_stats();
+    for (int g=1; g<=gens; g++){
+        world->cycle();
+        if (g % sample == 0){
+            result.curve.push_back(stats.population);
+        }
+        // The grid first seen again now was already part of the cycle one period ago.
+        if (stats.period){
+            result.stable_generation = stats.generation - stats.period;
+            result.period = stats.period;
+            break;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(t1 - t0).count();
+    result.generations = stats.generation;
+    result.population = stats.population;
+}
+
+// Steps runs that differ only in seed as one ensemble, each world until it repeats or the
+// budget is spent. Returns false for rules the ensemble cannot run (Larger-than-Life and
+// Generations), which then go through sweep_one(). Periods above ENSEMBLE_PERIOD_MAX are
+// not seen, and each run is charged an equal share of the ensemble's time.
+bool sweep_ensemble(const sweep_run* runs, size_t n, int gens, int sample, sweep_result* results){
+    thread_local EnsembleEngine ensemble;
+    World* world = sweep_world(runs[0]);
+    if (!world){
+        for (size_t i=0; i<n; i++){
+            results[i].ok = false;
+        }
+        return true;
+    }
+    const rule_t& rule = world->get_rule();
+    if (rule.range > 1 || rule.states > 2){
+        return false;
+    }
+    ensemble.resize(runs[0].size.columns, runs[0].size.rows, n);
+    ensemble.set_rule(rule.birth, rule.survive);
+    std::vector<uint64_t> seeds(n);
+    for (size_t i=0; i<n; i++){
+        seeds[i] = runs[i].seed;
+    }
+    ensemble.fill_random(seeds.data(), runs[0].density);
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<uint32_t> populations(n);
+    std::vector<uint8_t> periods(n);
+    std::vector<bool> running(n, true);
+    ensemble.count(populations.data());
+    for (size_t i=0; i<n; i++){
+        sweep_result& result = results[i];
+        result.ok = true;
+        snprintf(result.rule, RULE_NAME_LEN, "%s", rule.name);
+        result.curve.assign(1, populations[i]);
+        result.stable_generation = -1;
+        result.period = 0;
+    }
+    size_t live = n;
+    for (int g=1; g<=gens && live; g++){
+        ensemble.step();
+        ensemble.periods(periods.data());
+        // Populations are only counted when some world needs one.
+        bool settled = false;
+        for (size_t i=0; i<n; i++){
+            settled = settled || (running[i] && periods[i]);
+        }
+        if (settled || g % sample == 0 || g == gens){
+            ensemble.count(populations.data());
+        }
+        for (size_t i=0; i<n; i++){
+            if (!running[i]){
+                continue;
+            }
+            sweep_result& result = results[i];
+            if (g % sample == 0){
+                result.curve.push_back(populations[i]);
+            }
+            if (periods[i] || g == gens){
+                result.stable_generation = periods[i] ? g - periods[i] : -1;
+                result.period = periods[i];
+                result.generations = g;
+                result.population = populations[i];
+                running[i] = false;
+                live--;
+            }
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t1 - t0).count() / n;
+    for (size_t i=0; i<n; i++){
+        results[i].seconds = seconds;
+    }
+    return true;
+}
+
+void print_result(FILE* out, FILE* curves, size_t index, const sweep_run& run, const sweep_result& result, int sample){
+    if (!result.ok){
+        fprintf(stderr, "Run %ld: invalid rule '%s' or grid %ldx%ld, skipped.\n", index, run.rule.c_str(), run.size.columns, run.size.rows);
+        return;
+    }
+    // Larger-than-Life rule names hold commas, so they are quoted.
+    const char* quote = strchr(result.rule, ',') ? "\"" : "";
+    size_t cells = run.size.columns * run.size.rows;
+    fprintf(out, "%ld,%s%s%s,%.4f,%lu,%ld,%ld,%lu,%ld,%.6f,%ld,%ld,%.6f\n",
+            index, quote, result.rule, quote, run.density, run.seed, run.size.columns, run.size.rows,
+            result.generations, result.population, (double) result.population / cells,
+            result.stable_generation, result.period, result.seconds);
+    if (curves){
+        for (size_t i=0; i<result.curve.size(); i++){
+            fprintf(curves, "%ld,%ld,%ld\n", index, i * sample, result.curve[i]);
+        }
+    }
+}
+
+int main(int argc, char** argv){
+    int gens = SWEEP_GENS;
+    int sample = SWEEP_SAMPLE;
+    size_t jobs = std::thread::hardware_concurrency();
+    size_t ensemble = SWEEP_ENSEMBLE;
+    uint64_t first_seed = 1;
+    size_t seeds = SWEEP_SEEDS;
+    std::vector<int> modes;
+    std::vector<std::string> rules;
+    std::vector<double> densities;
+    std::vector<sweep_size> sizes;
+    const char* out_path = NULL;
+    const char* curves_path = NULL;
+    for (int i=1; i<argc; i++){
+        bool ok = true;
+        if (strcmp(argv[i], "--gens") == 0 && i + 1 < argc){
+            gens = atoi(argv[++i]);
+        }else if (strcmp(argv[i], "--modes") == 0 && i + 1 < argc){
+            ok = for_each_field(argv[++i], ',', [&](const std::string& f){ modes.push_back(atoi(f.c_str()) % MODES); return true; });
+        }else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc){
+            // Semicolons, since Larger-than-Life rules hold commas.
+            ok = for_each_field(argv[++i], ';', [&](const std::string& f){ rules.push_back(f); return true; });
+        }else if (strcmp(argv[i], "--densities") == 0 && i + 1 < argc){
+            ok = for_each_field(argv[++i], ',', [&](const std::string& f){ densities.push_back(atof(f.c_str())); return true; });
+        }else if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc){
+            seeds = strtoul(argv[++i], NULL, 10);
+        }else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc){
+            first_seed = strtoull(argv[++i], NULL, 0);
+        }else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc){
+            ok = for_each_field(argv[++i], ',', [&](const std::string& f){
+                sizes.push_back({0, 0});
+                return sscanf(f.c_str(), "%ldx%ld", &sizes.back().columns, &sizes.back().rows) == 2;
+            });
+        }else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc){
+            jobs = atoi(argv[++i]);
+        }else if (strcmp(argv[i], "--ensemble") == 0 && i + 1 < argc){
+            ensemble = strtoul(argv[++i], NULL, 10);
+        }else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc){
+            sample = atoi(argv[++i]);
+        }else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc){
+            out_path = argv[++i];
+        }else if (strcmp(argv[i], "--curves") == 0 && i + 1 < argc){
+            curves_path = argv[++i];
+        }else{
+            ok = false;
+        }
+        if (!ok){
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    gens = std::max(gens, 1);
+    sample = std::max(sample, 1);
+    jobs = std::max<size_t>(jobs, 1);
+    if (modes.empty() && rules.empty()){
+        for (int mode=0; mode<MODES; mode++){
+            modes.push_back(mode);
+        }
+    }
+    if (densities.empty()){
+        for (int digit=0; digit<SWEEP_DIGITS; digit++){
+            densities.push_back((double) digit / 11);
+        }
+    }
+    if (sizes.empty()){
+        sizes.push_back({256, 256});
+    }
+
+    std::vector<sweep_run> runs;
+    for (const sweep_size& size : sizes){
+        for (size_t r=0; r<modes.size() + rules.size(); r++){
+            for (double density : densities){
+                for (size_t s=0; s<seeds; s++){
+                    sweep_run run;
+                    run.rule = (r < modes.size()) ? "" : rules[r - modes.size()];
+                    run.mode = (r < modes.size()) ? modes[r] : 0;
+                    run.density = density;
+                    run.seed = first_seed + s;
+                    run.size = size;
+                    runs.push_back(run);
+                }
+            }
+        }
+    }
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    FILE* curves = curves_path ? fopen(curves_path, "w") : NULL;
+    if (!out || (curves_path && !curves)){
+        fprintf(stderr, "Cannot write '%s'.\n", !out ? out_path : curves_path);
+        return 1;
+    }
+    fprintf(out, "run,rule,density,seed,columns,rows,generations,population,final_density,stable_generation,period,seconds\n");
+    if (curves){
+        fprintf(curves, "run,generation,population\n");
+    }
+
+    // Seeds are the innermost loop above, so the runs of one ensemble are consecutive.
+    std::vector<sweep_batch> batches;
+    for (size_t r=0; r<runs.size(); r++){
+        const sweep_run* first = batches.empty() ? nullptr : &runs[batches.back().first];
+        if (first && batches.back().count < ensemble && first->rule == runs[r].rule && first->mode == runs[r].mode
+            && first->density == runs[r].density && first->size.columns == runs[r].size.columns && first->size.rows == runs[r].size.rows){
+            batches.back().count++;
+        }else{
+            batches.push_back({r, 1});
+        }
+    }
+
+    // One batch per job, each on a single thread. Rows are written in run order as soon as
+    // every earlier run has finished, so a long sweep can be followed as it goes.
+    std::vector<sweep_result> results(runs.size());
+    std::mutex mutex;
+    size_t next = 0;
+    ThreadPool pool(jobs);
+    auto t0 = std::chrono::steady_clock::now();
+    pool.run(batches.size(), [&](size_t b){
+        const sweep_batch& batch = batches[b];
+        if (batch.count < 2 || !sweep_ensemble(&runs[batch.first], batch.count, gens, sample, &results[batch.first])){
+            for (size_t r=batch.first; r<batch.first + batch.count; r++){
+                sweep_one(runs[r], gens, sample, results[r]);
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t r=batch.first; r<batch.first + batch.count; r++){
+            results[r].done = true;
+        }
+        while (next < runs.size() && results[next].done){
+            print_result(out, curves, next, runs[next], results[next], sample);
+            results[next].curve = std::vector<size_t>();
+            next++;
+        }
+        fflush(out);
+    });
+    auto t1 = std::chrono::steady_clock::now();
+    fprintf(stderr, "%ld runs on %ld threads in %.2f s.\n", runs.size(), pool.size(), std::chrono::duration<double>(t1 - t0).count());
+    if (out != stdout){
+        fclose(out);
+    }
+    if (curves){
+        fclose(curves);
+    }
+    return 0;
+}
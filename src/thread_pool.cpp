@@ -0,0 +1,100 @@
+#include "thread_pool.h"
+
+
+ThreadPool::ThreadPool(size_t threads) :
+        m_job(nullptr), m_job_count(0), m_next_job(0), m_jobs_done(0), m_batch(0), m_quit(false)
+    {
+        start(threads);
+}
+
+ThreadPool::~ThreadPool(){
+        join();
+}
+
+void ThreadPool::start(size_t threads){
+        m_quit = false;
+        for (size_t t=1; t<threads; t++){
+            m_workers.emplace_back(&ThreadPool::worker_loop, this);
+        }
+}
+
+void ThreadPool::join(){
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_start_cv.notify_all();
+        for (std::thread& worker : m_workers){
+            worker.join();
+        }
+        m_workers.clear();
+}
+
+void ThreadPool::resize(size_t threads){
+        if (threads < 1){
+            threads = 1;
+        }
+        join();
+        start(threads);
+}
+
+size_t ThreadPool::size(){
+        return m_workers.size() + 1;
+}
+
+// Must be called with m_mutex held.
+bool ThreadPool::take_job(size_t* job){
+        if (m_next_job >= m_job_count){
+            return false;
+        }
+        *job = m_next_job++;
+        return true;
+}
+
+void ThreadPool::worker_loop(){
+        size_t seen_batch = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true){
+            m_start_cv.wait(lock, [&]{ return m_quit || m_batch != seen_batch; });
+            if (m_quit){
+                return;
+            }
+            seen_batch = m_batch;
+            size_t job;
+            while (take_job(&job)){
+                const std::function<void(size_t)>* fn = m_job;
+                lock.unlock();
+                (*fn)(job);
+                lock.lock();
+                m_jobs_done++;
+            }
+            if (m_jobs_done == m_job_count){
+                m_done_cv.notify_all();
+            }
+        }
+}
+
+void ThreadPool::run(size_t jobs, const std::function<void(size_t)>& job){
+        if (m_workers.empty() || jobs < 2){
+            for (size_t j=0; j<jobs; j++){
+                job(j);
+            }
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_job_count = jobs;
+        m_next_job = 0;
+        m_jobs_done = 0;
+        m_batch++;
+        m_start_cv.notify_all();
+        size_t j;
+        while (take_job(&j)){
+            lock.unlock();
+            job(j);
+            lock.lock();
+            m_jobs_done++;
+        }
+        m_done_cv.wait(lock, [&]{ return m_jobs_done == m_job_count; });
+        m_job = nullptr;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Persistent worker pool. run() hands out job indices 0..jobs-1 to the workers and the
+// calling thread, and returns only once every job has finished (acts as the barrier).
+class ThreadPool{
+    private:
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_start_cv;
+        std::condition_variable m_done_cv;
+        const std::function<void(size_t)>* m_job;
+        size_t m_job_count;
+        size_t m_next_job;
+        size_t m_jobs_done;
+        size_t m_batch;
+        bool m_quit;
+
+        void worker_loop();
+        bool take_job(size_t* job);
+        void start(size_t threads);
+        void join();
+
+    public:
+        ThreadPool(size_t threads);
+        ~ThreadPool();
+        void resize(size_t threads);
+        size_t size();
+        void run(size_t jobs, const std::function<void(size_t)>& job);
+};
@@ -0,0 +1,96 @@
+#include "tile_map.h"
+
+#include <string.h>
+
+
+TileMap::TileMap() :
+        m_tiles_x(0), m_tiles_y(0), m_tile_count(0),
+        m_changed(nullptr), m_active(nullptr), m_stats(nullptr)
+    {
+}
+
+TileMap::~TileMap(){
+        delete[] m_changed;
+        delete[] m_active;
+        delete[] m_stats;
+}
+
+void TileMap::resize(size_t columns, size_t rows){
+        delete[] m_changed;
+        delete[] m_active;
+        delete[] m_stats;
+        m_tiles_x = (columns + TILE_W - 1) / TILE_W;
+        m_tiles_y = (rows + TILE_H - 1) / TILE_H;
+        m_tile_count = m_tiles_x * m_tiles_y;
+        m_changed = new uint8_t[m_tile_count];
+        m_active = new uint8_t[m_tile_count];
+        m_stats = new tile_stats[m_tile_count]();
+        reset();
+}
+
+size_t TileMap::get_tiles_x(){ return m_tiles_x; }
+size_t TileMap::get_tiles_y(){ return m_tiles_y; }
+size_t TileMap::get_tile_count(){ return m_tile_count; }
+
+size_t TileMap::get_tile_of(size_t x, size_t y){
+        return (x / TILE_W) + ((y / TILE_H) * m_tiles_x);
+}
+
+// For whole-grid rewrites: every tile is recomputed on the next step.
+void TileMap::reset(){
+        mark_all();
+}
+
+void TileMap::mark_all(){
+        memset(m_changed, 1, m_tile_count);
+}
+
+void TileMap::mark_cell(size_t x, size_t y){
+        m_changed[get_tile_of(x, y)] = 1;
+}
+
+// Turns last generation's change flags into this generation's active set (each changed
+// tile activates its torus neighbourhood), then clears the flags. Returns the active count.
+size_t TileMap::prepare(){
+        memset(m_active, 0, m_tile_count);
+        for (size_t ty=0; ty<m_tiles_y; ty++){
+            for (size_t tx=0; tx<m_tiles_x; tx++){
+                if (!m_changed[tx + (ty * m_tiles_x)]){
+                    continue;
+                }
+                for (int dy=-1; dy<=1; dy++){
+                    size_t ny = (ty + m_tiles_y + dy) % m_tiles_y;
+                    for (int dx=-1; dx<=1; dx++){
+                        size_t nx = (tx + m_tiles_x + dx) % m_tiles_x;
+                        m_active[nx + (ny * m_tiles_x)] = 1;
+                    }
+                }
+            }
+        }
+        memset(m_changed, 0, m_tile_count);
+        size_t active = 0;
+        for (size_t t=0; t<m_tile_count; t++){
+            active += m_active[t];
+        }
+        return active;
+}
+
+bool TileMap::is_active(size_t tile){
+        return m_active[tile];
+}
+
+void TileMap::set_changed(size_t tile, bool changed){
+        m_changed[tile] = changed;
+}
+
+// A skipped tile holds the same cells next generation: its population is unchanged, with
+// no births or deaths, and its oldest cell is one generation older.
+void TileMap::skip(size_t tile){
+        m_stats[tile].births = 0;
+        m_stats[tile].deaths = 0;
+        m_stats[tile].max_age += (m_stats[tile].population != 0);
+}
+
+tile_stats& TileMap::get_stats(size_t tile){
+        return m_stats[tile];
+}
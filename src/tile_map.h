@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "rng.h"
+
+// Tile width matches one BitEngine word so a tile is a whole-word span.
+#define TILE_W 64
+#define TILE_H 32
+
+// Per-tile figures from the last step; World sums them into world_stats. A skipped tile
+// keeps its population and hash.
+struct tile_stats{
+    size_t population;
+    size_t births;
+    size_t deaths;
+    size_t max_age;
+    uint64_t hash;              // XOR of group_key() over the tile's non-empty 8-cell groups.
+};
+
+// Zobrist key of one group of 8 cells (the bytes read as one word) in a given state. Keys
+// are derived rather than stored, so there is no table the size of the grid; an empty
+// group has key 0 so it never has to be visited.
+static inline uint64_t group_key(size_t group, uint64_t cells){
+    return cells ? splitmix64(group ^ (cells * 0xFF51AFD7ED558CCDULL)) : 0;
+}
+
+
+// Per-tile activity for World::cycle(). A tile is recomputed only if it or one of its
+// 8 neighbour tiles changed in the previous generation; all other tiles are known to
+// be still and are skipped.
+class TileMap{
+    private:
+        size_t m_tiles_x;
+        size_t m_tiles_y;
+        size_t m_tile_count;
+        uint8_t* m_changed;
+        uint8_t* m_active;
+        tile_stats* m_stats;
+
+    public:
+        TileMap();
+        ~TileMap();
+        void resize(size_t columns, size_t rows);
+        size_t get_tiles_x();
+        size_t get_tiles_y();
+        size_t get_tile_count();
+        size_t get_tile_of(size_t x, size_t y);
+        void reset();
+        void mark_all();
+        void mark_cell(size_t x, size_t y);
+        size_t prepare();
+        bool is_active(size_t tile);
+        void set_changed(size_t tile, bool changed);
+        void skip(size_t tile);
+        tile_stats& get_stats(size_t tile);
+};
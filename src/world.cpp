@@ -1,14 +1,15 @@
 #include "world.h"
 
 #define LD_RATIO 0.2
-
-static char log_buffer[1024];
+#define JUMP_LOG2 10
+#define JUMP_LOG2_MAX 40
+#define WORLD_SEED 1
 
 const int8_t sur_d[] = {0, -1, -1, 0, 1, 1, 1, 0, -1,  0, 0, 1, 1, 1, 0, -1, -1, -1};
 const double weight_grid[] =  {0, 1, sqrt(2), 1, sqrt(2), 1, sqrt(2), 1, sqrt(2)};
 
-void xy_to_pos(int* pos, int x, int y, int columns){
-    if (x < 0 || x >= columns || y < 0 || y >= columns){
+void xy_to_pos(int* pos, int x, int y, int columns, int rows){
+    if (x < 0 || x >= columns || y < 0 || y >= rows){
         *pos = -2;
         return;
     }
@@ -23,56 +24,79 @@ void pos_to_xy(int* x, int* y, int pos, int columns){
 }
 
 
-uint8_t get_random_cell_value(double ld_ratio){
-    int cutoff = (int) (65536.0 * ld_ratio);
-    int r = rand() % 65536;
-    if (r > cutoff){
-        return 0;
-    }else{
-        return 1;
+// Zobrist hash of a span of the grid over 8-cell groups (x0 is a multiple of 8). With old
+// set it returns the change from old to cells instead, mixing only the groups that differ.
+static uint64_t hash_span(const uint8_t* cells, const uint8_t* old, size_t columns, size_t x0, size_t x1, size_t y0, size_t y1){
+    const size_t groups = (columns + 7) / 8;
+    uint64_t h = 0;
+    for (size_t y=y0; y<y1; y++){
+        const uint8_t* row = cells + (y * columns);
+        const uint8_t* old_row = old ? old + (y * columns) : nullptr;
+        for (size_t x=x0; x<x1; x+=8){
+            size_t n = std::min<size_t>(8, x1 - x);
+            uint64_t a = 0, b = 0;
+            memcpy(&a, row + x, n);
+            if (old_row){
+                memcpy(&b, old_row + x, n);
+            }
+            if (a != b){
+                size_t g = (y * groups) + (x / 8);
+                h ^= group_key(g, a) ^ group_key(g, b);
+            }
+        }
     }
+    return h;
 }
 
+// The eight byte-grid cells of the low eight bits of v, read as one word the way
+// hash_span() reads them.
+static inline uint64_t spread8(uint64_t v){
+    uint64_t m = ((v & 0xFF) * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+    return ((m + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+}
 
-uint8_t rule_perish(uint8_t vi){ return vi & 0; }
-uint8_t rule_rest(uint8_t vi){ return vi & 1; }
-uint8_t rule_wake(uint8_t vi){ return vi | 1; }
-uint8_t rule_flip(uint8_t vi){ return vi ^ 1; } // “birth but not survive” behavior of B/S rules.
 
-char game_mode_names_full[MODES][35] = {"B3_S23_CONWAY", "B1357_S1357_Replicator", "B2_S_Seeds", "B25_S4", "B3_S012345678_Life_without_death",  "B34_S34_34_Life", "B35678_S5678_Diamoeba", "B36_S125_2x2", "B36_S23_HighLife", "B3678_S34678_Day_Night", "B368_S245_Morley", "B4678_S35678_Anneal"};
-const char game_mode_names[MODES][20] = {"CONWAY", "Replicator", "Seeds", "B25_S4", "Life_without_death", "34_Life", "Diamoeba", "2x2", "HighLife", "Day_Night", "Morley", "Anneal"};
+char game_mode_names_full[MODES][35] = {"B3_S23_CONWAY", "B1357_S1357_Replicator", "B2_S_Seeds", "B25_S4", "B3_S012345678_Life_without_death",  "B34_S34_34_Life", "B35678_S5678_Diamoeba", "B36_S125_2x2", "B36_S23_HighLife", "B3678_S34678_Day_Night", "B368_S245_Morley", "B4678_S35678_Anneal", "R5,C0,M1,S34..58,B34..45,NM_Bosco", "B2_S_C3_Brians_Brain", "B2_S345_C4_Star_Wars"};
+const char game_mode_names[MODES][20] = {"CONWAY", "Replicator", "Seeds", "B25_S4", "Life_without_death", "34_Life", "Diamoeba", "2x2", "HighLife", "Day_Night", "Morley", "Anneal", "Bosco", "Brians_Brain", "Star_Wars"};
+const char engine_names[ENGINES][10] = {"scalar", "bitpack", "simd"};
 
 
-World::World(size_t screen_h, size_t screen_w, size_t cell_size) :
-        m_screen_h(screen_h), m_screen_w(screen_w), m_cell_size(cell_size)
+World::World(size_t screen_h, size_t screen_w, size_t cell_size, size_t columns, size_t rows) :
+        m_screen_h(screen_h), m_screen_w(screen_w), m_cell_size(cell_size),
+        m_columns(0), m_rows(0), m_grit_count(0),
+        m_draw_cell_size(cell_size), m_draw_columns(0), m_draw_rows(0),
+        m_camera_x(0), m_camera_y(0), m_camera_scale(cell_size), m_posted_window(), m_window_pending(false), m_snapshot_window(),
+        m_cell_value_a(nullptr), m_cell_value_b(nullptr), m_cell_births(nullptr), m_birth_base(0),
+        m_pool(std::thread::hardware_concurrency())
     {
         
-        m_field_h = m_screen_h - 40;
+        m_field_h = m_screen_h - HUD_H;
         m_field_w = m_screen_w;
-
-        m_columns = m_field_w / m_cell_size;
-        m_rows    = m_field_h / m_cell_size;
-        m_grit_count = m_columns * m_rows;
-        m_remainder_w = m_field_w - (m_cell_size * m_columns);
-        m_remainder_h = m_field_h - (m_cell_size * m_rows);
-        sprintf(log_buffer, "%s: height: %ld, width: %ld.", __func__, m_field_h, m_field_w);
-        logger(log_buffer, 4);
-        sprintf(log_buffer, "%s: cols: %ld, rows: %ld, cells: %ld.", __func__, m_columns, m_rows, m_grit_count);
-        logger(log_buffer, 4);
-        sprintf(log_buffer, "%s: rem_w: %ld, rem_h: %ld.", __func__, m_remainder_w, m_remainder_h);
-        logger(log_buffer, 4);
-        m_cell_value_a = new uint8_t[m_grit_count];
-        m_cell_value_b = new uint8_t[m_grit_count];
-        m_cell_ages = new size_t[m_grit_count];
-        m_max_age = 0;
-        m_cell_values[0] = m_cell_value_a;
-        m_cell_values[1] = m_cell_value_b;
+        LOG(4, "%s: height: %ld, width: %ld.", __func__, m_field_h, m_field_w);
+        m_ages_enabled = true;
+        m_history_len = 0;
+        m_history_head = 0;
+        m_stop_on_period = true;
+        m_seed = WORLD_SEED;
         m_cycle_turn = 0;
-        m_live_count = 0;
-        m_ld_ratio = 0;
+        m_stats = {};
+        m_rule = {};
+        m_tiles_enabled = true;
+        m_hashlife_dirty = true;
+        m_jump_log2 = JUMP_LOG2;
+        m_unbounded = false;
+        m_view_x = 0;
+        m_view_y = 0;
+        m_engine = _ENGINE_BITPACK;
+        m_cells_dirty = false;
+        LOG(4, "%s: simd isa: %s.", __func__, m_simd_engine.get_isa_name());
+        if (!resize(columns, rows, cell_size, false)){
+            resize(GRID_MIN, GRID_MIN, GRID_CELL_SIZE, false);
+        }
         m_mode_ix = _CONWAY;
         m_mode_str = game_mode_names[m_mode_ix];
         m_new_mode_str = game_mode_names[m_mode_ix];
+        m_rule_input[0] = '\0';
         select_game_mode(m_mode_ix);
         setup_cells(LD_RATIO);
 }
@@ -80,194 +104,183 @@ World::World(size_t screen_h, size_t screen_w, size_t cell_size) :
 World::~World(){ 
         delete[] m_cell_value_a;
         delete[] m_cell_value_b;
-        delete[] m_cell_ages;
+        delete[] m_cell_births;
+}
+
+// Reallocates the grid as columns x rows cells drawn cell_size pixels wide; a zero side
+// fits the field at that cell size. With keep set the old contents stay centred, cropped
+// or padded with dead cells, and keep their ages; otherwise the grid starts empty. In
+// unbounded mode the plane keeps everything and the view moves to stay centred.
+bool World::resize(size_t columns, size_t rows, size_t cell_size, bool keep){
+        sync_cells();
+        if (cell_size < 1 || cell_size > CELL_SIZE_MAX){
+            LOG(2, "%s: cell size %ld is outside 1..%d.", __func__, cell_size, CELL_SIZE_MAX);
+            return false;
+        }
+        columns = columns ? columns : m_field_w / cell_size;
+        rows = rows ? rows : m_field_h / cell_size;
+        if (columns < GRID_MIN || rows < GRID_MIN || columns * rows > GRID_CELLS_MAX){
+            LOG(2, "%s: %ldx%ld cells is outside %dx%d..%ld cells.", __func__, columns, rows, GRID_MIN, GRID_MIN, GRID_CELLS_MAX);
+            return false;
+        }
+        size_t count = columns * rows;
+        uint8_t* cells_a = new uint8_t[count]();
+        uint8_t* cells_b = new uint8_t[count]();
+        uint32_t* births = m_ages_enabled ? new uint32_t[count] : nullptr;
+        if (births){
+            std::fill(births, births + count, birth_stamp());
+        }
+
+        // Old cell x lands on x + dx; only the overlap is copied, a row at a time.
+        int64_t dx = ((int64_t) columns - (int64_t) m_columns) / 2;
+        int64_t dy = ((int64_t) rows - (int64_t) m_rows) / 2;
+        if (keep && m_grit_count){
+            const uint8_t* cur = m_cell_values[m_cycle_turn];
+            int64_t x0 = std::max<int64_t>(0, -dx), x1 = std::min<int64_t>(m_columns, columns - dx);
+            int64_t y0 = std::max<int64_t>(0, -dy), y1 = std::min<int64_t>(m_rows, rows - dy);
+            for (int64_t y=y0; y<y1; y++){
+                size_t from = (y * m_columns) + x0;
+                size_t to = ((y + dy) * columns) + x0 + dx;
+                memcpy(cells_a + to, cur + from, x1 - x0);
+                if (births && m_cell_births){
+                    memcpy(births + to, m_cell_births + from, (x1 - x0) * sizeof(uint32_t));
+                }
+            }
+        }
+        delete[] m_cell_value_a;
+        delete[] m_cell_value_b;
+        delete[] m_cell_births;
+        m_cell_value_a = cells_a;
+        m_cell_value_b = cells_b;
+        m_cell_births = births;
+        m_cell_values[0] = m_cell_value_a;
+        m_cell_values[1] = m_cell_value_b;
+        m_cycle_turn = 0;
+
+        m_columns = columns;
+        m_rows = rows;
+        m_grit_count = count;
+        m_cell_size = cell_size;
+        m_bit_engine.resize(m_columns, m_rows);
+        m_ltl_engine.resize(m_columns, m_rows);
+        m_bit_engine_dirty = true;
+        m_hashlife_dirty = true;
+        m_tiles.resize(m_columns, m_rows);
+        m_tiles_active = m_tiles.get_tile_count();
+        if (m_unbounded && keep){
+            m_view_x -= dx;
+            m_view_y -= dy;
+            m_sparse.store(m_cell_values[m_cycle_turn], m_columns, m_rows, m_view_x, m_view_y);
+            stamp_births();
+        }else{
+            reload_sparse();
+        }
+        recount_stats();
+        // Until the renderer asks for a window, snapshots show the whole grid at its coarsest level.
+        size_t levels = lod_levels(m_columns, m_rows, m_field_w, m_field_h);
+        m_snapshot_window = {levels, 0, 0, lod_blocks(m_columns, levels), lod_blocks(m_rows, levels)};
+        LOG(4, "%s: cols: %ld, rows: %ld, cells: %ld, cell size: %ld.", __func__, m_columns, m_rows, m_grit_count, m_cell_size);
+        return true;
+}
+
+// Halves or doubles the cell size and refits the grid to the field, keeping the centre.
+void World::change_cell_size(int delta){
+        size_t cell_size = (delta > 0) ? m_cell_size * 2 : m_cell_size / 2;
+        resize(0, 0, std::max<size_t>(1, std::min<size_t>(cell_size, CELL_SIZE_MAX)), true);
 }
 
 void World::select_game_mode(uint8_t mode){
-    switch (mode){
-        case _CONWAY:
-            get_rules_conway();
-            break;
-        case _REPLICATOR:
-            get_rules_replicator();
-            break;
-
-        case _SEEDS:
-            get_rules_seeds();
-            break;
-
-        case _B25_S4:
-            get_rules_b25_s4();
-            break;
-
-        case _LIFE_WITHOUT_DEATH:
-            get_rules_life_without_death();
-            break;
-
-        case _34_LIFE:
-            get_rules_34_life();
-            break;
-
-        case _DIAMOEBA:
-            get_rules_diamoeba();
-            break;
-
-        case _2X2:
-            get_rules_2x2();
-            break;
-
-        case _HIGHLIFE:
-            get_rules_highlife();
-            break;
-
-        case _DAY_NIGHT:
-            get_rules_day_night();
-            break;
-
-        case _MORLEY:
-            get_rules_morley();
-            break;
-
-        case _ANNEAL:
-            get_rules_anneal();
-            break;
-    }
+        rule_t rule;
+        if (parse_rule(game_mode_names_full[mode], &rule)){
+            set_rule(rule);
+        }
+}
+
+// Compiles the rule into the 18-entry transition table used by the scalar loop
+// and into the birth/survive masks used by the other engines. Dying states the new rule
+// does not have are cleared.
+void World::set_rule(const rule_t& rule){
+        if (rule.states < std::max<uint16_t>(m_rule.states, 2)){
+            drop_states(rule.states);
+        }
+        m_rule = rule;
+        compile_rule_table(&m_rule, m_rule_table);
+        m_tiles.mark_all();
+        m_hashlife_dirty = true;
+        m_simd_engine.set_rule(m_rule.birth, m_rule.survive);
+        m_ltl_engine.set_rule(m_rule);
+        m_generations_engine.set_rule(m_rule);
+        LOG(4, "%s: rule: %s.", __func__, m_rule.name);
+        // The plane only runs two-state Moore rules without B0, so cycle_unbounded() never
+        // sees any other.
+        if (m_unbounded && ((m_rule.birth & 1) || m_rule.range > 1 || m_rule.states > 2)){
+            LOG(2, "%s: rule %s cannot run unbounded, back to the torus.", __func__, m_rule.name);
+            toggle_unbounded();
+        }
+}
+
+// Clears every cell in a state of states or above.
+void World::drop_states(uint16_t states){
+        sync_cells();
+        uint8_t* cells = m_cell_values[m_cycle_turn];
+        for (size_t c=0; c<m_grit_count; c++){
+            cells[c] = (cells[c] < states) ? cells[c] : 0;
+        }
+        m_bit_engine_dirty = true;
+        m_hashlife_dirty = true;
+        m_tiles.reset();
+        reload_sparse();
+        recount_stats();
+}
+
+bool World::set_rule_string(const char* text){
+        rule_t rule;
+        if (!parse_rule(text, &rule)){
+            LOG(2, "%s: invalid rule '%s'.", __func__, text);
+            return false;
+        }
+        set_rule(rule);
+        m_mode_str = m_rule.name;
+        m_new_mode_str = m_rule.name;
+        return true;
+}
+
+void World::set_engine(uint8_t engine){
+        sync_cells();
+        m_engine = engine % ENGINES;
+        m_bit_engine_dirty = true;
+        m_tiles.mark_all();
+        LOG(4, "%s: engine: %s.", __func__, engine_names[m_engine]);
 }
 
-void World::get_rules_conway(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_perish;
-        m_rule_array[2] = &rule_rest;
-        m_rule_array[3] = &rule_wake;
-        m_rule_array[4] = &rule_perish;
-        m_rule_array[5] = &rule_perish;
-        m_rule_array[6] = &rule_perish;
-        m_rule_array[7] = &rule_perish;
-        m_rule_array[8] = &rule_perish;
-}
-
-
-void World::get_rules_replicator(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_wake;
-        m_rule_array[2] = &rule_perish;
-        m_rule_array[3] = &rule_wake;
-        m_rule_array[4] = &rule_perish;
-        m_rule_array[5] = &rule_wake;
-        m_rule_array[6] = &rule_perish;
-        m_rule_array[7] = &rule_wake;
-        m_rule_array[8] = &rule_perish;
-}
-void World::get_rules_seeds(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_perish;
-        m_rule_array[2] = &rule_flip;
-        m_rule_array[3] = &rule_perish;
-        m_rule_array[4] = &rule_perish;
-        m_rule_array[5] = &rule_perish;
-        m_rule_array[6] = &rule_perish;
-        m_rule_array[7] = &rule_perish;
-        m_rule_array[8] = &rule_perish;
-}
-void World::get_rules_b25_s4(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_perish;
-        m_rule_array[2] = &rule_flip;
-        m_rule_array[3] = &rule_perish;
-        m_rule_array[4] = &rule_rest;
-        m_rule_array[5] = &rule_flip;
-        m_rule_array[6] = &rule_perish;
-        m_rule_array[7] = &rule_perish;
-        m_rule_array[8] = &rule_perish;
-}
-void World::get_rules_life_without_death(){
-        m_rule_array[0] = &rule_rest;
-        m_rule_array[1] = &rule_rest;
-        m_rule_array[2] = &rule_rest;
-        m_rule_array[3] = &rule_wake;
-        m_rule_array[4] = &rule_rest;
-        m_rule_array[5] = &rule_rest;
-        m_rule_array[6] = &rule_rest;
-        m_rule_array[7] = &rule_rest;
-        m_rule_array[8] = &rule_rest;
-}
-void World::get_rules_34_life(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_perish;
-        m_rule_array[2] = &rule_wake;
-        m_rule_array[3] = &rule_wake;
-        m_rule_array[4] = &rule_perish;
-        m_rule_array[5] = &rule_perish;
-        m_rule_array[6] = &rule_perish;
-        m_rule_array[7] = &rule_perish;
-        m_rule_array[8] = &rule_perish;
-}
-void World::get_rules_2x2(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_flip;
-        m_rule_array[2] = &rule_flip;
-        m_rule_array[3] = &rule_wake;
-        m_rule_array[4] = &rule_perish;
-        m_rule_array[5] = &rule_flip;
-        m_rule_array[6] = &rule_wake;
-        m_rule_array[7] = &rule_perish;
-        m_rule_array[8] = &rule_perish;
-}
-void World::get_rules_highlife(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_perish;
-        m_rule_array[2] = &rule_rest;
-        m_rule_array[3] = &rule_wake;
-        m_rule_array[4] = &rule_perish;
-        m_rule_array[5] = &rule_perish;
-        m_rule_array[6] = &rule_flip;
-        m_rule_array[7] = &rule_perish;
-        m_rule_array[8] = &rule_perish;
-}
-void World::get_rules_day_night(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_perish;
-        m_rule_array[2] = &rule_perish;
-        m_rule_array[3] = &rule_wake;
-        m_rule_array[4] = &rule_rest;
-        m_rule_array[5] = &rule_perish;
-        m_rule_array[6] = &rule_wake;
-        m_rule_array[7] = &rule_wake;
-        m_rule_array[8] = &rule_wake;
-}
-void World::get_rules_morley(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_perish;
-        m_rule_array[2] = &rule_rest;
-        m_rule_array[3] = &rule_flip;
-        m_rule_array[4] = &rule_rest;
-        m_rule_array[5] = &rule_rest;
-        m_rule_array[6] = &rule_flip;
-        m_rule_array[7] = &rule_perish;
-        m_rule_array[8] = &rule_flip;
-}
-void World::get_rules_anneal(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_perish;
-        m_rule_array[2] = &rule_perish;
-        m_rule_array[3] = &rule_rest;
-        m_rule_array[4] = &rule_flip;
-        m_rule_array[5] = &rule_rest;
-        m_rule_array[6] = &rule_wake;
-        m_rule_array[7] = &rule_wake;
-        m_rule_array[8] = &rule_wake;
-}
-
-void World::get_rules_diamoeba(){
-        m_rule_array[0] = &rule_perish;
-        m_rule_array[1] = &rule_perish;
-        m_rule_array[2] = &rule_perish;
-        m_rule_array[3] = &rule_flip;
-        m_rule_array[4] = &rule_perish;
-        m_rule_array[5] = &rule_wake;
-        m_rule_array[6] = &rule_wake;
-        m_rule_array[7] = &rule_wake;
-        m_rule_array[8] = &rule_wake;
+void World::next_engine(){
+        set_engine(m_engine + 1);
+}
+
+void World::set_threads(size_t threads){
+        m_pool.resize(threads);
+        LOG(4, "%s: threads: %ld.", __func__, m_pool.size());
+}
+
+size_t World::get_threads(){
+        return m_pool.size();
+}
+
+void World::set_jump_log2(int log2_steps){
+        m_jump_log2 = std::max(0, std::min(log2_steps, JUMP_LOG2_MAX));
+}
+
+void World::change_jump_log2(int delta){
+        set_jump_log2(m_jump_log2 + delta);
+}
+
+void World::set_hashlife_node_limit(size_t nodes){
+        m_hashlife.set_node_limit(nodes);
+}
+
+void World::toggle_tiles(){
+        m_tiles_enabled = !m_tiles_enabled;
+        LOG(4, "%s: tiles: %d.", __func__, m_tiles_enabled);
 }
 
 void World::prompt_mode(){
@@ -277,10 +290,28 @@ void World::prompt_digit(){
         m_state_sub = _RANDOM; 
 }
 
+void World::rule_input_push(char c){
+        size_t n = strlen(m_rule_input);
+        if (n < RULE_NAME_LEN - 1){
+            m_rule_input[n] = c;
+            m_rule_input[n + 1] = '\0';
+        }
+}
+
+void World::rule_input_pop(){
+        size_t n = strlen(m_rule_input);
+        if (n > 0){
+            m_rule_input[n - 1] = '\0';
+        }
+}
+
 void World::set_mode(int value){
         if (value == 0){
-            m_mode_str = m_new_mode_str;
-            select_game_mode(m_mode_ix);
+            if (m_rule_input[0] == '\0' || !set_rule_string(m_rule_input)){
+                m_mode_str = m_new_mode_str;
+                select_game_mode(m_mode_ix);
+            }
+            m_rule_input[0] = '\0';
             m_state_sub = _NONE;
         }else{
             if (m_mode_ix == 0 && value == -1){
@@ -290,8 +321,7 @@ void World::set_mode(int value){
             }
             m_new_mode_str = game_mode_names[m_mode_ix];
         }
-        sprintf(log_buffer, "%s: cmix: %d, cms: %s.", __func__, m_mode_ix, m_new_mode_str);
-        logger(log_buffer, 4);
+        LOG(4, "%s: cmix: %d, cms: %s.", __func__, m_mode_ix, m_new_mode_str);
 }
 
 void World::set_state(int state){ m_state = state; }
@@ -314,43 +344,405 @@ void World::toggle_rs(){
 
 
 void World::clear(){
+        sync_cells();
         for (size_t c=0; c<m_grit_count; c++){
             m_cell_values[m_cycle_turn][c] = 0;
-            m_cell_ages[c] = 0;
-            m_max_age = 0;
         }
+        m_bit_engine_dirty = true;
+        m_hashlife_dirty = true;
+        m_tiles.reset();
+        reload_sparse();
+        m_stats.generation = 0;
+        stamp_births();
+        recount_stats();
 }
 
+// Each fill from the keyboard moves on to the next seed of the sequence, so a session
+// started with --seed replays exactly.
 void World::gradient(){
-        for (size_t c=0; c<m_grit_count; c++){
-            double ratio = (double) (c % m_columns) / (double)  (m_columns + 1);
-            uint8_t c_value = get_random_cell_value(ratio);
-            m_cell_values[m_cycle_turn][c] = c_value;
-            m_cell_ages[c] = c_value;
-            m_max_age = 1;
+        std::vector<uint32_t> cutoffs(m_columns);
+        for (size_t x=0; x<m_columns; x++){
+            cutoffs[x] = random_cutoff((double) x / (double) (m_columns + 1));
         }
+        m_seed = splitmix64(m_seed);
+        fill_random(cutoffs.data());
 }
 
 void World::randomize_cells(uint8_t ld_value){
         double ld_ratio = (double) ld_value / 11;
-        sprintf(log_buffer, "%s: ld_value: %d, ld_ratio: %f.", __func__, ld_value, ld_ratio);
-        logger(log_buffer, 4);
+        LOG(4, "%s: ld_value: %d, ld_ratio: %f.", __func__, ld_value, ld_ratio);
+        m_seed = splitmix64(m_seed);
         setup_cells(ld_ratio);
 }
 
+// Fills the grid from the current seed.
 void World::setup_cells(double ld_ratio){
-        for (size_t c=0; c<m_grit_count; c++){
-            uint8_t c_value = get_random_cell_value(ld_ratio);
-            m_cell_values[m_cycle_turn][c] = c_value;
-            m_cell_ages[c] = c_value;
-            m_max_age = 1;
-        }
+        std::vector<uint32_t> cutoffs(m_columns, random_cutoff(ld_ratio));
+        fill_random(cutoffs.data());
+}
+
+// Cell (x, y) is alive when its sample is below cutoffs[x]. Bands of rows are filled on the
+// pool; the samples depend only on the seed and the cell index, so the grid is the same
+// for any thread count.
+void World::fill_random(const uint32_t* cutoffs){
+        sync_cells();
+        uint8_t* cells = m_cell_values[m_cycle_turn];
+        size_t bands = (m_rows + RANDOM_BAND_ROWS - 1) / RANDOM_BAND_ROWS;
+        m_pool.run(bands, [&](size_t band){
+            size_t y1 = std::min(m_rows, (band + 1) * RANDOM_BAND_ROWS);
+            for (size_t y=band * RANDOM_BAND_ROWS; y<y1; y++){
+                random_cells(cells + (y * m_columns), y * m_columns, m_columns, m_seed, cutoffs);
+            }
+        });
+        LOG(4, "%s: seed: 0x%016lx.", __func__, m_seed);
+        m_bit_engine_dirty = true;
+        m_hashlife_dirty = true;
+        m_tiles.reset();
+        reload_sparse();
+        m_stats.generation = 0;
+        stamp_births();
+        recount_stats();
+}
+
+// Fills the grid at the default ratio from seed.
+void World::set_seed(uint64_t seed){
+        m_seed = seed;
+        setup_cells(LD_RATIO);
+}
+
+uint64_t World::get_seed(){
+        return m_seed;
 }
 
 void World::set_cell(size_t index, int value){
+        if (index >= m_grit_count){
+            return;
+        }
+        sync_cells();
+        size_t x = index % m_columns;
+        size_t y = index / m_columns;
         m_cell_values[m_cycle_turn][index] = value;
-        m_cell_ages[index] = value;
-        m_max_age = 1;
+        if (m_ages_enabled){
+            m_cell_births[index] = birth_stamp();
+        }
+        m_bit_engine_dirty = true;
+        m_hashlife_dirty = true;
+        m_tiles.mark_cell(x, y);
+        if (m_unbounded){
+            m_sparse.set_cell(m_view_x + x, m_view_y + y, value);
+        }
+        count_tile(m_tiles.get_tile_of(x, y));
+        sum_stats();
+        reset_history();
+}
+
+// Replaces the grid with the pattern in path, its top-left corner at (x, y) or centred for
+// PATTERN_CENTRE, and selects the rule named in its header. In unbounded mode the whole
+// pattern goes into the sparse plane; on the torus, cells outside the grid are dropped.
+bool World::load_pattern(const char* path, int64_t x, int64_t y){
+        sync_cells();
+        PatternReader reader;
+        if (!reader.open(path)){
+            return false;
+        }
+        if (reader.get_rule()[0] != '\0' && !set_rule_string(reader.get_rule())){
+            LOG(2, "%s: keeping rule %s.", __func__, m_rule.name);
+        }
+        if (x == PATTERN_CENTRE){
+            x = ((int64_t)m_columns - reader.get_width()) / 2;
+        }
+        if (y == PATTERN_CENTRE){
+            y = ((int64_t)m_rows - reader.get_height()) / 2;
+        }
+
+        uint8_t* cur = m_cell_values[m_cycle_turn];
+        memset(cur, 0, m_grit_count);
+        size_t cells, clipped = 0;
+        if (m_unbounded){
+            m_sparse.clear();
+            cells = reader.read([&](int64_t px, int64_t py, int64_t n){
+                m_sparse.set_run(m_view_x + x + px, m_view_y + y + py, n);
+            });
+            m_sparse.store(cur, m_columns, m_rows, m_view_x, m_view_y);
+        }else{
+            const int64_t columns = m_columns, rows = m_rows;
+            cells = reader.read([&](int64_t px, int64_t py, int64_t n){
+                int64_t gy = y + py;
+                int64_t gx0 = std::max<int64_t>(x + px, 0), gx1 = std::min<int64_t>(x + px + n, columns);
+                if (gy < 0 || gy >= rows || gx0 >= gx1){
+                    clipped += n;
+                    return;
+                }
+                clipped += n - (gx1 - gx0);
+                memset(cur + (gy * columns) + gx0, 1, gx1 - gx0);
+            });
+        }
+        m_bit_engine_dirty = true;
+        m_hashlife_dirty = true;
+        m_tiles.reset();
+        m_stats.generation = 0;
+        stamp_births();
+        recount_stats();
+        LOG(4, "%s: '%s': %ld cells at %ld, %ld.", __func__, path, cells, x, y);
+        if (clipped){
+            LOG(2, "%s: %ld cells outside the grid were dropped.", __func__, clipped);
+        }
+        return true;
+}
+
+// Saves the live area of the grid; the format follows the extension (.rle, .lif, .cells).
+// The formats are two-state, so under a Generations rule only the live cells are written.
+bool World::save_pattern(const char* path){
+        sync_cells();
+        return write_pattern(path, m_cell_values[m_cycle_turn], m_columns, m_rows, m_rule.name);
+}
+
+// Writes the current buffer, birth stamps, rule, mode and generation to a state file.
+bool World::save_state(const char* path){
+        sync_cells();
+        state_header header = {};
+        header.columns = m_columns;
+        header.rows = m_rows;
+        header.generation = m_stats.generation;
+        header.birth = m_rule.birth;
+        header.survive = m_rule.survive;
+        header.mode_ix = m_mode_ix;
+        snprintf(header.rule_name, RULE_NAME_LEN, "%s", m_rule.name);
+        // Files hold the low 32 bits of each birth generation, independent of m_birth_base.
+        std::vector<uint32_t> births;
+        if (m_ages_enabled){
+            births.resize(m_grit_count);
+            for (size_t c=0; c<m_grit_count; c++){
+                births[c] = (uint32_t)(m_birth_base + m_cell_births[c]);
+            }
+        }
+        return write_state_file(path, &header, m_cell_values[m_cycle_turn], m_ages_enabled ? births.data() : nullptr, m_rule.states > 2);
+}
+
+// Restores a state file, resizing the grid to the saved size first. The mapped sections
+// are copied straight into the buffers: the packed rows into the bitpack engine and the
+// birth stamps into m_cell_births. Only the byte grid is unpacked, eight cells at a time.
+bool World::load_state(const char* path){
+        sync_cells();
+        StateFile file;
+        if (!file.open(path)){
+            return false;
+        }
+        const state_header* h = file.get_header();
+        if ((h->columns != m_columns || h->rows != m_rows) && !resize(h->columns, h->rows, m_cell_size, false)){
+            LOG(2, "%s: '%s' is %ldx%ld, which the grid cannot take.", __func__, path, h->columns, h->rows);
+            return false;
+        }
+        // The canonical name carries everything, including Larger-than-Life ranges.
+        rule_t rule;
+        char name[RULE_NAME_LEN];
+        memcpy(name, h->rule_name, RULE_NAME_LEN);
+        name[RULE_NAME_LEN - 1] = '\0';
+        if (!parse_rule(name, &rule)){
+            memset(&rule, 0, sizeof(rule));
+            rule.birth = h->birth;
+            rule.survive = h->survive;
+            rule.range = 1;
+            memcpy(rule.name, name, RULE_NAME_LEN);
+        }
+        set_rule(rule);
+        m_mode_ix = h->mode_ix % MODES;
+        m_mode_str = m_rule.name;
+        m_new_mode_str = game_mode_names[m_mode_ix];
+
+        unpack_cells(file.get_words(), m_columns, m_rows, m_cell_values[m_cycle_turn]);
+        if (file.get_states() && m_rule.states > 2){
+            const uint8_t* states = file.get_states();
+            uint8_t* cells = m_cell_values[m_cycle_turn];
+            for (size_t c=0; c<m_grit_count; c++){
+                cells[c] = (states[c] < m_rule.states) ? states[c] : 0;
+            }
+        }
+        if (m_engine == _ENGINE_BITPACK){
+            m_bit_engine.load_words(file.get_words());
+            m_bit_engine_dirty = false;
+        }else{
+            m_bit_engine_dirty = true;
+        }
+        m_stats.generation = h->generation;
+        stamp_births();
+        if (m_ages_enabled && file.get_births()){
+            // Ages are the 32-bit difference to the saved generation; they stay exact up to
+            // AGE_KEEP, the room left below the current stamp.
+            const uint32_t* births = file.get_births();
+            m_birth_base = (h->generation > AGE_KEEP) ? h->generation - AGE_KEEP : 0;
+            const uint32_t now = birth_stamp();
+            for (size_t c=0; c<m_grit_count; c++){
+                uint32_t age = (uint32_t) h->generation - births[c];
+                m_cell_births[c] = now - std::min(age, now);
+            }
+        }
+        m_hashlife_dirty = true;
+        m_tiles.reset();
+        reload_sparse();
+        recount_stats();
+        LOG(4, "%s: '%s': generation: %ld, rule: %s, population: %ld.", __func__, path, m_stats.generation, m_rule.name, m_stats.population);
+        return true;
+}
+
+// A live cell's age is 1 in the generation it was born in.
+size_t World::get_cell_age(size_t index){
+        sync_cells();
+        if (!m_cell_values[m_cycle_turn][index]){
+            return 0;
+        }
+        return m_ages_enabled ? (size_t)(birth_stamp() - m_cell_births[index]) + 1 : 1;
+}
+
+// Restarts every cell's age at the current generation, after a rewrite of the whole grid.
+// The stamps then count from this generation.
+void World::stamp_births(){
+        m_birth_base = m_stats.generation;
+        if (!m_ages_enabled){
+            return;
+        }
+        std::fill(m_cell_births, m_cell_births + m_grit_count, 0);
+}
+
+// Stamp of the current generation. Stamps are relative to m_birth_base so they stay
+// 32-bit, and ages are always taken as a 32-bit difference of two stamps.
+uint32_t World::birth_stamp(){
+        return (uint32_t)(m_stats.generation - m_birth_base);
+}
+
+// Moves m_birth_base up once the generation no longer fits a stamp, as after a long
+// HashLife jump. Ages up to AGE_KEEP stay exact and older cells saturate at that age.
+void World::rebase_births(){
+        if (m_stats.generation - m_birth_base <= UINT32_MAX){
+            return;
+        }
+        const uint64_t base = m_stats.generation - AGE_KEEP;
+        const uint64_t shift = base - m_birth_base;
+        m_birth_base = base;
+        if (!m_ages_enabled){
+            return;
+        }
+        for (size_t c=0; c<m_grit_count; c++){
+            m_cell_births[c] = (m_cell_births[c] > shift) ? (uint32_t)(m_cell_births[c] - shift) : 0;
+        }
+        for (size_t t=0; t<m_tiles.get_tile_count(); t++){
+            m_tiles.get_stats(t).max_age = std::min<size_t>(m_tiles.get_stats(t).max_age, AGE_KEEP);
+        }
+}
+
+// Headless runs can drop the birth stamps: steps then skip the age bookkeeping, ages read
+// as 1 for every live cell and max_age stays 0. Re-enabling restarts all ages.
+void World::set_ages_enabled(bool enabled){
+        if (enabled == m_ages_enabled){
+            return;
+        }
+        m_ages_enabled = enabled;
+        delete[] m_cell_births;
+        m_cell_births = enabled ? new uint32_t[m_grit_count] : nullptr;
+        stamp_births();
+        recount_stats();
+}
+
+// Recounts one tile's population, oldest cell and hash after an edit; births and deaths
+// are only known from a step and read as zero.
+void World::count_tile(size_t tile){
+        size_t tx = tile % m_tiles.get_tiles_x();
+        size_t ty = tile / m_tiles.get_tiles_x();
+        size_t x0 = tx * TILE_W, x1 = std::min(x0 + TILE_W, m_columns);
+        size_t y0 = ty * TILE_H, y1 = std::min(y0 + TILE_H, m_rows);
+        const uint8_t* cur = m_cell_values[m_cycle_turn];
+        const uint32_t now = birth_stamp();
+        uint32_t oldest = 0;
+        tile_stats stats = {};
+        for (size_t y=y0; y<y1; y++){
+            for (size_t c=(y * m_columns) + x0; c<(y * m_columns) + x1; c++){
+                uint32_t live = (cur[c] == 1);
+                stats.population += live;
+                if (m_ages_enabled){
+                    oldest = std::max(oldest, (now - m_cell_births[c]) * live);
+                }
+            }
+        }
+        stats.max_age = (stats.population && m_ages_enabled) ? oldest + 1 : 0;
+        stats.hash = hash_span(cur, nullptr, m_columns, x0, x1, y0, y1);
+        m_tiles.get_stats(tile) = stats;
+}
+
+void World::sum_stats(){
+        m_stats.population = 0;
+        m_stats.births = 0;
+        m_stats.deaths = 0;
+        m_stats.max_age = 0;
+        m_stats.hash = 0;
+        for (size_t t=0; t<m_tiles.get_tile_count(); t++){
+            const tile_stats& stats = m_tiles.get_stats(t);
+            m_stats.population += stats.population;
+            m_stats.births += stats.births;
+            m_stats.deaths += stats.deaths;
+            m_stats.max_age = std::max(m_stats.max_age, stats.max_age);
+            m_stats.hash ^= stats.hash;
+        }
+        if (m_unbounded){
+            // The plane reaches past the view, so its totals come from the chunks.
+            m_sparse.count();
+            m_stats.population = m_sparse.get_stats().population;
+            m_stats.hash = m_sparse.get_stats().hash;
+        }
+}
+
+// Full recount after a whole-grid rewrite; the new grid has no history.
+void World::recount_stats(){
+        sync_cells();
+        for (size_t t=0; t<m_tiles.get_tile_count(); t++){
+            count_tile(t);
+        }
+        sum_stats();
+        reset_history();
+}
+
+// Forgets earlier generations. The current grid is kept as the first entry, so a cycle
+// that passes through it is found after one period rather than two.
+void World::reset_history(){
+        m_history[0] = {m_stats.hash, m_stats.population, m_stats.generation};
+        m_history_len = 1;
+        m_history_head = 1;
+        m_stats.period = 0;
+}
+
+// Looks the new grid hash up among the last HASH_HISTORY generations. A match with the same
+// population means the grid repeats with that period. The run stops the first time a
+// period is found; once resumed it keeps going and the HUD shows the period.
+void World::detect_period(){
+        size_t period = 0;
+        for (size_t i=0; i<m_history_len; i++){
+            const hash_entry& e = m_history[i];
+            if (e.hash == m_stats.hash && e.population == m_stats.population){
+                size_t p = m_stats.generation - e.generation;
+                if (period == 0 || p < period){
+                    period = p;
+                }
+            }
+        }
+        bool found = period && !m_stats.period;
+        m_stats.period = period;
+        m_history[m_history_head] = {m_stats.hash, m_stats.population, m_stats.generation};
+        m_history_head = (m_history_head + 1) % HASH_HISTORY;
+        m_history_len = std::min(m_history_len + 1, (size_t)HASH_HISTORY);
+        if (found){
+            LOG(4, "%s: period %ld at generation %ld.", __func__, period, m_stats.generation);
+            if (m_stop_on_period){
+                stop();
+            }
+        }
+}
+
+void World::toggle_stop_on_period(){
+        m_stop_on_period = !m_stop_on_period;
+        LOG(4, "%s: stop on period: %d.", __func__, m_stop_on_period);
+}
+
+const world_stats& World::get_stats(){
+        return m_stats;
 }
 
 int World::get_neighbour_value_count(size_t index){
@@ -370,149 +762,783 @@ int World::get_neighbour_value_count(size_t index){
             ox = ox % m_columns;
             oy = oy % m_rows;
             //if (ox>=0 && oy>=0 && ox<(int)m_columns && oy<(int)m_rows ){
-                xy_to_pos(&other_ix, ox, oy, m_columns); // Other node's postion.
+                xy_to_pos(&other_ix, ox, oy, m_columns, m_rows); // Other node's postion.
                 sum = sum + m_cell_values[m_cycle_turn][other_ix];
             //}
         }
         return sum;
 }
 
+void World::cycle_scalar(size_t y0, size_t y1, size_t x0, size_t x1){
+        for (size_t y=y0; y<y1; y++){
+            for (size_t c=(y * m_columns) + x0; c<(y * m_columns) + x1; c++){
+                int neighbour_count = get_neighbour_value_count(c);
+                m_cell_values[!m_cycle_turn][c] = m_rule_table[(m_cell_values[m_cycle_turn][c] * 9) + neighbour_count];
+            }
+        }
+}
+
+void World::cycle_simd(size_t y0, size_t y1, size_t x0, size_t x1){
+        for (size_t y=y0; y<y1; y++){
+            m_simd_engine.step_span(m_cell_values[m_cycle_turn], m_cell_values[!m_cycle_turn], m_columns, m_rows, y, x0, x1);
+        }
+}
+
+// Computes one tile into the off buffer with the scalar or simd engine, or with the
+// Generations engine for rules with dying states. Returns whether any cell in it changed.
+bool World::cycle_tile(size_t tx, size_t ty){
+        size_t x0 = tx * TILE_W, x1 = std::min(x0 + TILE_W, m_columns);
+        size_t y0 = ty * TILE_H, y1 = std::min(y0 + TILE_H, m_rows);
+        if (m_rule.states > 2){
+            for (size_t y=y0; y<y1; y++){
+                m_generations_engine.step_span(m_cell_values[m_cycle_turn], m_cell_values[!m_cycle_turn], m_columns, m_rows, y, x0, x1);
+            }
+            return update_tile(tx, ty);
+        }
+        switch (m_engine){
+            case _ENGINE_SIMD:
+                cycle_simd(y0, y1, x0, x1);
+                break;
+            default:
+                cycle_scalar(y0, y1, x0, x1);
+                break;
+        }
+        return update_tile(tx, ty);
+}
+
+// Stamps the cells born in a freshly stepped tile with the current generation and records
+// the tile's stats. The tile hash only changes by the keys of the groups that differ.
+// Returns whether any cell in it changed.
+bool World::update_tile(size_t tx, size_t ty){
+        size_t x0 = tx * TILE_W, x1 = std::min(x0 + TILE_W, m_columns);
+        size_t y0 = ty * TILE_H, y1 = std::min(y0 + TILE_H, m_rows);
+        size_t tile = tx + (ty * m_tiles.get_tiles_x());
+        const uint8_t* cur = m_cell_values[m_cycle_turn];
+        const uint8_t* nxt = m_cell_values[!m_cycle_turn];
+        tile_stats stats = {};
+        if (m_ages_enabled){
+            const uint32_t now = birth_stamp();
+            uint32_t oldest = 0;
+            for (size_t y=y0; y<y1; y++){
+                for (size_t c=(y * m_columns) + x0; c<(y * m_columns) + x1; c++){
+                    uint8_t was = (cur[c] == 1), live = (nxt[c] == 1);
+                    uint8_t born = live & (was ^ 1);
+                    if (born){
+                        m_cell_births[c] = now;
+                    }
+                    oldest = std::max(oldest, (now - m_cell_births[c]) * live);
+                    stats.population += live;
+                    stats.births += born;
+                    stats.deaths += was & (live ^ 1);
+                }
+            }
+            stats.max_age = stats.population ? oldest + 1 : 0;
+        }else{
+            for (size_t y=y0; y<y1; y++){
+                for (size_t c=(y * m_columns) + x0; c<(y * m_columns) + x1; c++){
+                    uint8_t was = (cur[c] == 1), live = (nxt[c] == 1);
+                    stats.population += live;
+                    stats.births += live & (was ^ 1);
+                    stats.deaths += was & (live ^ 1);
+                }
+            }
+        }
+        // Dying cells change state without a birth or death.
+        bool changed = (stats.births | stats.deaths) != 0;
+        for (size_t y=y0; !changed && m_rule.states > 2 && y<y1; y++){
+            changed = memcmp(cur + (y * m_columns) + x0, nxt + (y * m_columns) + x0, x1 - x0) != 0;
+        }
+        stats.hash = m_tiles.get_stats(tile).hash;
+        if (changed){
+            stats.hash ^= hash_span(nxt, cur, m_columns, x0, x1, y0, y1);
+        }
+        m_tiles.get_stats(tile) = stats;
+        return changed;
+}
+
+// Steps one tile on the packed rows alone; a tile is word tx of rows y0..y1. Population,
+// births and deaths are popcounts of the words, the hash changes by the 8-cell groups whose
+// byte differs, and ages only visit the cells born or dying. The tile's oldest age goes up
+// by one unless its oldest cell died, which is the only case that rescans the live cells.
+// Returns whether any cell changed.
+bool World::cycle_tile_packed(size_t tx, size_t ty){
+        size_t y0 = ty * TILE_H, y1 = std::min(y0 + TILE_H, m_rows);
+        size_t tile = tx + (ty * m_tiles.get_tiles_x());
+        m_bit_engine.step_span(y0, y1, tx, tx + 1, m_rule.birth, m_rule.survive);
+        const size_t words = m_bit_engine.get_row_words();
+        const uint64_t* cur = m_bit_engine.get_rows();
+        const uint64_t* nxt = m_bit_engine.get_next_rows();
+        const size_t groups = (m_columns + 7) / 8;
+        const tile_stats prev = m_tiles.get_stats(tile);
+        const uint32_t now = birth_stamp();
+        const uint32_t oldest_stamp = now - (uint32_t) prev.max_age;
+        bool oldest_died = false;
+        tile_stats stats = {};
+        stats.hash = prev.hash;
+        for (size_t y=y0; y<y1; y++){
+            uint64_t c = cur[(y * words) + tx], n = nxt[(y * words) + tx];
+            uint64_t born = n & ~c, died = c & ~n;
+            stats.population += __builtin_popcountll(n);
+            stats.births += __builtin_popcountll(born);
+            stats.deaths += __builtin_popcountll(died);
+            for (uint64_t diff=c ^ n; diff; ){
+                size_t k = __builtin_ctzll(diff) / 8;
+                size_t g = (y * groups) + (tx * 8) + k;
+                stats.hash ^= group_key(g, spread8(n >> (8 * k))) ^ group_key(g, spread8(c >> (8 * k)));
+                diff &= ~((uint64_t)0xFF << (8 * k));
+            }
+            if (m_ages_enabled){
+                uint32_t* births = m_cell_births + (y * m_columns) + (tx * TILE_W);
+                for (; born; born &= born - 1){
+                    births[__builtin_ctzll(born)] = now;
+                }
+                for (; died && !oldest_died; died &= died - 1){
+                    oldest_died = births[__builtin_ctzll(died)] == oldest_stamp;
+                }
+            }
+        }
+        if (m_ages_enabled && stats.population){
+            if (!prev.population){
+                stats.max_age = 1;
+            }else if (!oldest_died){
+                stats.max_age = prev.max_age + 1;
+            }else{
+                uint32_t oldest = 0;
+                for (size_t y=y0; y<y1; y++){
+                    const uint32_t* births = m_cell_births + (y * m_columns) + (tx * TILE_W);
+                    for (uint64_t n=nxt[(y * words) + tx]; n; n &= n - 1){
+                        oldest = std::max(oldest, now - births[__builtin_ctzll(n)]);
+                    }
+                }
+                stats.max_age = oldest + 1;
+            }
+        }
+        m_tiles.get_stats(tile) = stats;
+        return (stats.births | stats.deaths) != 0;
+}
+
+// Brings the byte grid up to the packed rows, which bitpack steps leave it behind, in
+// bands of rows on the pool; in unbounded mode, up to the plane.
+void World::sync_cells(){
+        if (!m_cells_dirty){
+            return;
+        }
+        m_cells_dirty = false;
+        if (m_unbounded){
+            sync_view();
+            return;
+        }
+        const size_t words = m_bit_engine.get_row_words();
+        const uint64_t* rows = m_bit_engine.get_rows();
+        uint8_t* cells = m_cell_values[m_cycle_turn];
+        size_t bands = (m_rows + RANDOM_BAND_ROWS - 1) / RANDOM_BAND_ROWS;
+        m_pool.run(bands, [&](size_t band){
+            size_t y0 = band * RANDOM_BAND_ROWS;
+            size_t y1 = std::min(m_rows, y0 + RANDOM_BAND_ROWS);
+            unpack_cells(rows + (y0 * words), m_columns, y1 - y0, cells + (y0 * m_columns));
+        });
+}
+
+// Advances one generation, then stops the run once the grid is empty or full, or when it
+// starts repeating.
 void World::cycle(){
-        for (size_t c=0; c<m_grit_count; c++){
-            int neighbour_count = get_neighbour_value_count(c);
-            uint8_t new_val = m_cell_values[m_cycle_turn][c];
-            new_val = (*m_rule_array[neighbour_count])(new_val);
-            m_cell_ages[c] = (m_cell_ages[c] + new_val) * new_val; // Increment if 1, set to 0 if 0;
-            m_cell_values[!m_cycle_turn][c] = new_val;
+        m_stats.generation++;
+        rebase_births();
+        if (m_unbounded){
+            cycle_unbounded();
+        }else if (m_rule.range > 1){
+            cycle_ltl();
+        }else{
+            cycle_torus();
+        }
+        detect_period();
+        LOG(5, "%s: gen: %ld, population: %ld, births: %ld, deaths: %ld, hash: %016lx.", __func__, m_stats.generation, m_stats.population, m_stats.births, m_stats.deaths, m_stats.hash);
+        if (m_stats.population == 0 || (!m_unbounded && m_stats.population == m_grit_count)){
+            stop();
+        }
+}
+
+// Steps all active tiles, one tile row per pool job. Inactive tiles are still and the
+// off buffer already holds their cells, and their ages advance with the generation. The
+// bitpack engine steps its own rows and leaves the byte grid to sync_cells().
+void World::cycle_torus(){
+        const bool packed = (m_engine == _ENGINE_BITPACK) && m_rule.states <= 2;
+        if (packed && m_bit_engine_dirty){
+            m_bit_engine.load(m_cell_values[m_cycle_turn]);
+            m_bit_engine_dirty = false;
+        }else if (!packed){
+            sync_cells();
+        }
+        if (!m_tiles_enabled){
+            m_tiles.mark_all();
         }
+        m_tiles_active = m_tiles.prepare();
+        size_t tiles_x = m_tiles.get_tiles_x();
+        m_pool.run(m_tiles.get_tiles_y(), [&](size_t ty){
+            for (size_t tx=0; tx<tiles_x; tx++){
+                size_t tile = tx + (ty * tiles_x);
+                if (m_tiles.is_active(tile)){
+                    m_tiles.set_changed(tile, packed ? cycle_tile_packed(tx, ty) : cycle_tile(tx, ty));
+                }else{
+                    m_tiles.skip(tile);
+                }
+            }
+        });
+        if (packed){
+            m_bit_engine.swap();
+            m_cells_dirty = true;
+        }else{
+            m_bit_engine_dirty = true;
+            m_cycle_turn = !m_cycle_turn;
+        }
+        m_hashlife_dirty = true;
+        sum_stats();
+}
+
+// Larger-than-Life step, whatever the engine: the row sums of the whole grid first, then
+// the next generation, each split into one band of rows per thread. Every tile is then
+// restamped and recounted as in unbounded mode.
+void World::cycle_ltl(){
+        sync_cells();
+        const uint8_t* cur = m_cell_values[m_cycle_turn];
+        uint8_t* nxt = m_cell_values[!m_cycle_turn];
+        size_t bands = m_pool.size();
+        m_pool.run(bands, [&](size_t band){
+            m_ltl_engine.sum_rows(cur, (band * m_rows) / bands, ((band + 1) * m_rows) / bands);
+        });
+        m_pool.run(bands, [&](size_t band){
+            m_ltl_engine.step_rows(cur, nxt, (band * m_rows) / bands, ((band + 1) * m_rows) / bands);
+        });
+        size_t tiles_x = m_tiles.get_tiles_x();
+        m_pool.run(m_tiles.get_tiles_y(), [&](size_t ty){
+            for (size_t tx=0; tx<tiles_x; tx++){
+                update_tile(tx, ty);
+            }
+        });
         m_cycle_turn = !m_cycle_turn;
+        m_bit_engine_dirty = true;
+        m_hashlife_dirty = true;
+        sum_stats();
+}
+
+// Unbounded mode: the grid is a viewport at (m_view_x, m_view_y) onto m_sparse, which
+// owns the state. Rules with B0 would fill the plane and drop back to the torus, and the
+// plane only steps the Moore neighbourhood.
+void World::toggle_unbounded(){
+        sync_cells();
+        if (!m_unbounded && (m_rule.birth & 1)){
+            LOG(2, "%s: rule %s has B0, staying bounded.", __func__, m_rule.name);
+            return;
+        }
+        if (!m_unbounded && (m_rule.range > 1 || m_rule.states > 2)){
+            LOG(2, "%s: rule %s is not a two-state Moore rule, staying bounded.", __func__, m_rule.name);
+            return;
+        }
+        m_unbounded = !m_unbounded;
+        reload_sparse();
+        m_bit_engine_dirty = true;
+        m_hashlife_dirty = true;
+        m_tiles.reset();
+        recount_stats();
+        LOG(4, "%s: unbounded: %d.", __func__, m_unbounded);
+}
+
+void World::reload_sparse(){
+        if (m_unbounded){
+            m_sparse.clear();
+            m_sparse.load(m_cell_values[m_cycle_turn], m_columns, m_rows, m_view_x, m_view_y);
+        }
+}
+
+void World::pan(int64_t dx, int64_t dy){
+        if (!m_unbounded){
+            return;
+        }
+        m_view_x += dx;
+        m_view_y += dy;
+        m_sparse.store(m_cell_values[m_cycle_turn], m_columns, m_rows, m_view_x, m_view_y);
+        m_cells_dirty = false;
+        stamp_births();
+        recount_stats();
+}
+
+// Steps the plane alone and takes the totals from its chunks, so a step costs the live
+// area whatever the size of the view. The view is only copied out by sync_cells().
+void World::cycle_unbounded(){
+        m_sparse.step(m_rule.birth, m_rule.survive, m_pool);
+        const sparse_stats& stats = m_sparse.get_stats();
+        m_stats.population = stats.population;
+        m_stats.births = stats.births;
+        m_stats.deaths = stats.deaths;
+        m_stats.hash = stats.hash;
+        m_cells_dirty = true;
+}
+
+// Copies the plane into the view. Cells live now that were not at the last copy are
+// stamped as born now, so ages in the view count from when it was last read rather than
+// from the exact generation. The view's tiles are recounted for its oldest age.
+void World::sync_view(){
+        const uint8_t* cur = m_cell_values[m_cycle_turn];
+        uint8_t* nxt = m_cell_values[!m_cycle_turn];
+        m_sparse.store(nxt, m_columns, m_rows, m_view_x, m_view_y);
+        if (m_ages_enabled){
+            const uint32_t now = birth_stamp();
+            for (size_t c=0; c<m_grit_count; c++){
+                if (nxt[c] && !cur[c]){
+                    m_cell_births[c] = now;
+                }
+            }
+        }
+        m_cycle_turn = !m_cycle_turn;
+        m_bit_engine_dirty = true;
+        m_hashlife_dirty = true;
+        size_t tiles_x = m_tiles.get_tiles_x();
+        m_pool.run(m_tiles.get_tiles_y(), [&](size_t ty){
+            for (size_t tx=0; tx<tiles_x; tx++){
+                count_tile(tx + (ty * tiles_x));
+            }
+        });
+        m_stats.max_age = 0;
+        for (size_t t=0; t<m_tiles.get_tile_count(); t++){
+            m_stats.max_age = std::max(m_stats.max_age, m_tiles.get_stats(t).max_age);
+        }
+}
+
+// Fast-forwards 2^m_jump_log2 generations with HashLife. For the jump the grid is a window
+// onto an unbounded plane, so patterns leaving it are kept off-screen rather than wrapped.
+// Consecutive jumps reuse the universe; any other step or edit re-imports the grid.
+void World::jump(){
+        sync_cells();
+        if (m_unbounded){
+            LOG(2, "%s: not available in unbounded mode.", __func__);
+            return;
+        }
+        if (m_rule.range > 1 || m_rule.states > 2){
+            LOG(2, "%s: rule %s is not a two-state Moore rule, cannot jump.", __func__, m_rule.name);
+            return;
+        }
+        if (!m_hashlife.set_rule(m_rule.birth, m_rule.survive)){
+            LOG(2, "%s: rule %s has B0, cannot jump.", __func__, m_rule.name);
+            return;
+        }
+        const uint8_t* cur = m_cell_values[m_cycle_turn];
+        uint8_t* nxt = m_cell_values[!m_cycle_turn];
+        if (m_hashlife_dirty){
+            m_hashlife.load(cur, m_columns, m_rows);
+            m_hashlife_dirty = false;
+        }
+        m_hashlife.advance(m_jump_log2);
+        m_hashlife.store(nxt, m_columns, m_rows);
+
+        // Survivors keep their stamp and so age by the whole jump; everything else is newborn.
+        m_stats.generation += (uint64_t)1 << m_jump_log2;
+        rebase_births();
+        if (m_ages_enabled){
+            const uint32_t now = birth_stamp();
+            for (size_t c=0; c<m_grit_count; c++){
+                if (nxt[c] && !cur[c]){
+                    m_cell_births[c] = now;
+                }
+            }
+        }
+        m_cycle_turn = !m_cycle_turn;
+        m_bit_engine_dirty = true;
+        m_tiles.reset();
+        recount_stats();
+        if (m_stats.population == 0){
+            stop();
+        }
+        LOG(4, "%s: 2^%d generations, population: %ld, nodes: %ld.", __func__, m_jump_log2, m_hashlife.get_population(), m_hashlife.get_node_count());
 }
 
 size_t World::get_cell_count(){
         return m_grit_count;
 }
 
-int World::get_cell_index_from_pos(int x, int y){
-        size_t xp = (x - (m_remainder_w / 2)) / m_cell_size;
-        size_t yp = (y - (m_remainder_h / 2)) / m_cell_size;
-        int pos;
-        xy_to_pos(&pos, xp, yp, m_columns);
-        return pos;
+size_t World::get_columns(){
+        return m_columns;
+}
+
+size_t World::get_rows(){
+        return m_rows;
+}
+
+size_t World::get_cell_size(){
+        return m_cell_size;
 }
 
-void World::draw_colour_rgb(size_t x, size_t y, int colour){
-        int colour_ix = m_cell_ages[colour];
-        if (colour_ix >= 361){
-            colour_ix = 361;
+const uint8_t* World::get_cells(){
+        sync_cells();
+        return m_cell_values[m_cycle_turn];
+}
+
+const char* World::get_engine_name(){
+        if (m_rule.range > 1){
+            return "ltl";
+        }
+        if (m_rule.states > 2){
+            return "generations";
         }
-        Color col = {
-            rgb_values[colour_ix][0], 
-            rgb_values[colour_ix][1],
-            rgb_values[colour_ix][2], 
-            255};
+        return m_unbounded ? "sparse" : engine_names[m_engine];
+}
+
+const char* World::get_rule_name(){
+        return m_rule.name;
+}
 
-        DrawRectangle(x+2, y+2, m_cell_size-2, m_cell_size-2, col);   
+const rule_t& World::get_rule(){
+        return m_rule;
 }
 
+// Sets the window snapshot() copies, as posted by the renderer when its view moves.
+void World::set_view_window(const lod_window& window){
+        m_snapshot_window = window;
+}
+
+// Copies the current generation and formats the HUD lines that read World state. Called
+// by SimThread between generations; the random-entry prompt is shown once per request.
+// Only the window set by set_view_window() is copied: cells and ages at level 0, otherwise
+// that level's densities, which read the packed rows directly while bitpack has stepped
+// past the byte grid. So the cost follows the view, not the grid.
+void World::snapshot(world_snapshot& out){
+        if (m_unbounded){
+            sync_cells();
+        }
+        lod_window w = m_snapshot_window;
+        w.level = std::min<size_t>(w.level, LOD_LEVELS_MAX);
+        w.x1 = std::min(w.x1, lod_blocks(m_columns, w.level));
+        w.y1 = std::min(w.y1, lod_blocks(m_rows, w.level));
+        w.x0 = std::min(w.x0, w.x1);
+        w.y0 = std::min(w.y0, w.y1);
+        const size_t columns = w.x1 - w.x0;
+        const size_t rows = w.y1 - w.y0;
+        out.columns = m_columns;
+        out.rows = m_rows;
+        out.cell_size = m_cell_size;
+        out.window = w;
+        out.cells.clear();
+        out.density.clear();
+        out.births.clear();
+        if (w.level && columns && rows){
+            out.density.resize(columns * rows);
+            if (m_cells_dirty){
+                lod_density_packed(m_bit_engine.get_rows(), m_bit_engine.get_row_words(), m_columns, m_rows, w, out.density.data(), m_pool);
+            }else{
+                lod_density(m_cell_values[m_cycle_turn], m_columns, m_rows, w, out.density.data(), m_pool);
+            }
+        }else if (!w.level){
+            out.cells.resize(columns * rows);
+            const size_t words = m_bit_engine.get_row_words();
+            for (size_t y=0; y<rows; y++){
+                uint8_t* dst = out.cells.data() + (y * columns);
+                if (m_cells_dirty){
+                    const uint64_t* src = m_bit_engine.get_rows() + ((w.y0 + y) * words);
+                    for (size_t x=w.x0; x<w.x1; x++){
+                        dst[x - w.x0] = (src[x / 64] >> (x % 64)) & 1;
+                    }
+                }else{
+                    memcpy(dst, m_cell_values[m_cycle_turn] + ((w.y0 + y) * m_columns) + w.x0, columns);
+                }
+            }
+            if (m_ages_enabled){
+                out.births.resize(columns * rows);
+                for (size_t y=0; y<rows; y++){
+                    memcpy(out.births.data() + (y * columns), m_cell_births + ((w.y0 + y) * m_columns) + w.x0, columns * sizeof(uint32_t));
+                }
+            }
+        }
+        out.birth_now = birth_stamp();
+        out.stats = m_stats;
+        out.state = m_state;
+        out.seed = m_seed;
+        out.states = m_rule.states;
+        snprintf(out.mode_text, RULE_NAME_LEN, "%s", m_mode_str);
+        if (m_unbounded){
+            snprintf(out.engine_text, HUD_TEXT_LEN, "Unbounded x%ld  view: %ld, %ld  chunks: %ld", m_pool.size(), m_view_x, m_view_y, m_sparse.get_chunk_count());
+        }else if (m_rule.range > 1){
+            snprintf(out.engine_text, HUD_TEXT_LEN, "Engine: ltl R%d x%ld", m_rule.range, m_pool.size());
+        }else if (m_rule.states > 2){
+            snprintf(out.engine_text, HUD_TEXT_LEN, "Engine: generations C%d x%ld  tiles: %ld/%ld", m_rule.states, m_pool.size(), m_tiles_active, m_tiles.get_tile_count());
+        }else if (m_engine == _ENGINE_SIMD){
+            snprintf(out.engine_text, HUD_TEXT_LEN, "Engine: %s (%s) x%ld  tiles: %ld/%ld  jump: 2^%d", engine_names[m_engine], m_simd_engine.get_isa_name(), m_pool.size(), m_tiles_active, m_tiles.get_tile_count(), m_jump_log2);
+        }else{
+            snprintf(out.engine_text, HUD_TEXT_LEN, "Engine: %s x%ld  tiles: %ld/%ld  jump: 2^%d", engine_names[m_engine], m_pool.size(), m_tiles_active, m_tiles.get_tile_count(), m_jump_log2);
+        }
+        out.prompt_text[0] = '\0';
+        if (m_state_sub == _RANDOM){
+            snprintf(out.prompt_text, HUD_TEXT_LEN, "%s", "RANDOM: Enter digit (0~9)");
+            m_state_sub = _NONE;
+        }
+        if (m_state_sub == _MODE){
+            if (m_rule_input[0] != '\0'){
+                snprintf(out.prompt_text, HUD_TEXT_LEN, "%s '%s'", "MODE: Type B/S rule and enter", m_rule_input);
+            }else{
+                snprintf(out.prompt_text, HUD_TEXT_LEN, "%s '%s'", "MODE: Press up/down or type rule, enter", m_new_mode_str);
+            }
+        }
+}
+
+// The whole grid and its birth stamps, as they are, for frame capture; births is left
+// empty with ages disabled. Called on the simulation thread after a generation.
+void World::copy_grid(std::vector<uint8_t>& cells, std::vector<uint32_t>& births, uint32_t* birth_now){
+        sync_cells();
+        cells.assign(m_cell_values[m_cycle_turn], m_cell_values[m_cycle_turn] + m_grit_count);
+        if (m_ages_enabled){
+            births.assign(m_cell_births, m_cell_births + m_grit_count);
+        }else{
+            births.clear();
+        }
+        *birth_now = birth_stamp();
+}
+
+// Goes through the camera and size of the last drawn frame, which is what the user clicked on.
+int World::get_cell_index_from_pos(int x, int y){
+        if (y >= (int) m_field_h || !m_draw_columns){
+            return -2;
+        }
+        double cx = m_camera_x + ((x - (m_field_w / 2.0)) / m_camera_scale);
+        double cy = m_camera_y + ((y - (m_field_h / 2.0)) / m_camera_scale);
+        if (cx < 0 || cy < 0){
+            return -2;
+        }
+        int pos;
+        xy_to_pos(&pos, cx, cy, m_draw_columns, m_draw_rows);
+        return pos;
+}
+
+#if RAYLIB_ENABLED
 void World::draw_colour(size_t x, size_t y, int colour){
         DrawRectangle(x+2, y+2, m_cell_size-2, m_cell_size-2, col_array[colour]);   
 }
 
+#endif
+
 void World::print_age_grit(){
         for (size_t c=0; c<m_grit_count; c++){
             if (c%m_columns==0){ printf("\n");}
-            m_max_age = std::max(m_max_age, m_cell_ages[c]);
-            printf("%ld ", m_cell_ages[c]);
+            printf("%ld ", get_cell_age(c));
         }
-        printf("\nMax age: %ld.\n", m_max_age);
+        printf("\nMax age: %ld.\n", m_stats.max_age);
 }
 
 
 void World::print_cell_grit(){
+        sync_cells();
         for (size_t c=0; c<m_grit_count; c++){
             if (c%m_columns==0){ printf("\n");}
             printf("%d ", m_cell_values[m_cycle_turn][c]);
         }
         printf("\n");
-        printf("live count: %ld, ratio: %.4f\n", m_live_count, m_ld_ratio);
+        printf("live count: %ld, ratio: %.4f\n", m_stats.population, (double) m_stats.population / m_grit_count);
 }
 
-void World::draw_text(const char* text, Color colour){
+#if RAYLIB_ENABLED
+void World::draw_text(const world_snapshot& snap, const char* text, Color colour){
         char text_buffer[255];
-        //size_t y_pos[] = {0, m_field_w/
-        size_t lv = m_live_count;
-        double rt = m_ld_ratio;
-        sprintf(text_buffer, "Mode: %s, live: %ld \t ratio: %1.4f \t", m_mode_str, lv, rt);
+        size_t lv = snap.stats.population;
+        double rt = (double) lv / (snap.columns * snap.rows);
+        sprintf(text_buffer, "Mode: %s, live: %ld \t ratio: %1.4f \t", snap.mode_text, lv, rt);
         DrawText(text_buffer, 0, m_field_h + 2, 16, COL_WHITE);
 
+        if (snap.stats.period){
+            sprintf(text_buffer, "Gen: %ld  births: %ld  deaths: %ld  max age: %ld  period: %ld", snap.stats.generation, snap.stats.births, snap.stats.deaths, snap.stats.max_age, snap.stats.period);
+        }else{
+            sprintf(text_buffer, "Gen: %ld  births: %ld  deaths: %ld  max age: %ld", snap.stats.generation, snap.stats.births, snap.stats.deaths, snap.stats.max_age);
+        }
+        DrawText(text_buffer, 0, m_field_h + 20, 16, COL_WHITE);
+
         sprintf(text_buffer, "Press 'q' to quit");
         DrawText(text_buffer, m_field_w/5, m_field_h + 2, 16, COL_WHITE);
 
+        DrawText(snap.engine_text, (m_field_w/10) * 3, m_field_h + 2, 16, COL_WHITE);
+
+        if (snap.gens_per_tick == 0){
+            sprintf(text_buffer, "Speed: max  %.0f gens/s  seed: 0x%lx", snap.gens_per_s, snap.seed);
+        }else{
+            sprintf(text_buffer, "Speed: %ld/tick  %.0f gens/s  seed: 0x%lx", snap.gens_per_tick, snap.gens_per_s, snap.seed);
+        }
+        DrawText(text_buffer, (m_field_w/10) * 3, m_field_h + 20, 16, COL_WHITE);
+
         sprintf(text_buffer, "%s", text);
         DrawText(text_buffer, (m_field_w - m_field_w/10), m_field_h + 2, 18, colour);
 
-        if (m_state_sub == _RANDOM){
-            sprintf(text_buffer, "%s", "RANDOM: Enter digit (0~9)");
-            DrawText(text_buffer, (m_field_w/2), m_field_h + 2, 16, COL_WHITE);
-            m_state_sub = _NONE;
-        }
-        if (m_state_sub == _MODE){
-            sprintf(text_buffer, "%s '%s'", "MODE: Press up/down and enter", m_new_mode_str);
-            DrawText(text_buffer, (m_field_w/2), m_field_h + 2, 16, COL_WHITE);
-            //m_state_sub = _NONE;
+        if (snap.prompt_text[0] != '\0'){
+            DrawText(snap.prompt_text, (m_field_w/2), m_field_h + 2, 16, COL_WHITE);
         }
 
 }
 
 
-void World::act_on_mouse(int mouse_button){
+// Index of the cell under the mouse, or negative when it is outside the grid. Read on the
+// render thread; the edit itself is posted to the simulation thread.
+int World::get_mouse_cell(){
     int mouse_x = GetMouseX();
     int mouse_y = GetMouseY();
-    int cell_index = get_cell_index_from_pos(mouse_x, mouse_y);
-    set_cell(cell_index, 1 - mouse_button);
+    return get_cell_index_from_pos(mouse_x, mouse_y);
 }
 
 
-void World::draw_cells(){
-        int xp, yp;
-        m_live_count = 0;
-        for (size_t i=0; i<m_grit_count; i++){
-            pos_to_xy(&xp, &yp, i, m_columns);
-            size_t x = (xp * m_cell_size) + (m_remainder_w / 2);
-            size_t y = (yp * m_cell_size) + (m_remainder_h / 2);
-            if (x < m_field_w - m_remainder_w && y < m_field_h - m_remainder_h){
-#if GRID_CELL_SIZE > 20
-                DrawRectangleLines(x, y, m_cell_size, m_cell_size, COL_GRAY);
-#endif
-                if (m_cell_values[m_cycle_turn][i]){
-                    m_live_count++;
-                    draw_colour_rgb(x, y, i);
+// Centres the grid at its own cell size, as it was before any zooming.
+void World::reset_camera(){
+        if (!m_draw_columns){
+            return;
+        }
+        m_camera_x = m_draw_columns / 2.0;
+        m_camera_y = m_draw_rows / 2.0;
+        m_camera_scale = m_draw_cell_size;
+        clamp_camera();
+}
+
+// Zooming out stops once the whole grid fits the field, and the centre stays on the grid.
+void World::clamp_camera(){
+        double fit = std::min((double) m_field_w / m_draw_columns, (double) m_field_h / m_draw_rows);
+        double min_scale = std::min(fit, (double) m_draw_cell_size);
+        m_camera_scale = std::max(min_scale, std::min(m_camera_scale, (double) CAMERA_SCALE_MAX));
+        m_camera_x = std::max(0.0, std::min(m_camera_x, (double) m_draw_columns));
+        m_camera_y = std::max(0.0, std::min(m_camera_y, (double) m_draw_rows));
+}
+
+// Zooms by CAMERA_ZOOM_STEP per wheel notch, keeping the cell under (x, y) in place.
+void World::zoom_camera(float steps, int x, int y){
+        if (!m_draw_columns){
+            return;
+        }
+        double old_scale = m_camera_scale;
+        double fx = x - (m_field_w / 2.0);
+        double fy = y - (m_field_h / 2.0);
+        m_camera_scale *= pow(CAMERA_ZOOM_STEP, steps);
+        clamp_camera();
+        m_camera_x += (fx / old_scale) - (fx / m_camera_scale);
+        m_camera_y += (fy / old_scale) - (fy / m_camera_scale);
+        clamp_camera();
+}
+
+// Moves the grid by a mouse drag of (dx, dy) pixels.
+void World::drag_camera(float dx, float dy){
+        if (!m_draw_columns){
+            return;
+        }
+        m_camera_x -= dx / m_camera_scale;
+        m_camera_y -= dy / m_camera_scale;
+        clamp_camera();
+}
+
+// Blocks of a pyramid level that the camera shows, including the partly visible ones at
+// the edges.
+lod_window World::get_visible_blocks(size_t level, size_t columns, size_t rows){
+        const double block = (size_t) 1 << level;
+        const double scale = m_camera_scale * block;
+        const double left = (m_camera_x / block) - ((m_field_w / 2.0) / scale);
+        const double top = (m_camera_y / block) - ((m_field_h / 2.0) / scale);
+        const double blocks_x = lod_blocks(columns, level), blocks_y = lod_blocks(rows, level);
+        lod_window w;
+        w.level = level;
+        w.x0 = std::max(0.0, std::min(blocks_x, floor(left)));
+        w.x1 = std::max(0.0, std::min(blocks_x, ceil(left + (m_field_w / scale))));
+        w.y0 = std::max(0.0, std::min(blocks_y, floor(top)));
+        w.y1 = std::max(0.0, std::min(blocks_y, ceil(top + (m_field_h / scale))));
+        return w;
+}
+
+// Hands out the window the snapshots should hold once it changes, for the caller to post
+// to the simulation thread. draw_cells() moves it when the view leaves it or changes level.
+bool World::take_view_window(lod_window* window){
+        if (!m_window_pending){
+            return false;
+        }
+        m_window_pending = false;
+        *window = m_posted_window;
+        return true;
+}
+
+
+// Fills one pixel per visible cell of the snapshot, with ages derived from the birth
+// stamps, and hands the buffer to the renderer, which uploads it as a single texture.
+// Zoomed out past one cell per pixel, the pixels come from the coarsest pyramid level
+// whose blocks still cover a pixel each, so a frame reads about one value per screen
+// pixel however large the grid is. The snapshot only holds the window the camera asked
+// for; after a pan or zoom the frames until the new window arrives draw what they have,
+// at its level, and leave the rest empty. The camera is reset when the grid or cell size
+// changes, which shows up with the first generation after a resize.
+void World::draw_cells(const world_snapshot& snap){
+        if (snap.columns != m_draw_columns || snap.rows != m_draw_rows || snap.cell_size != m_draw_cell_size){
+            m_draw_columns = snap.columns;
+            m_draw_rows = snap.rows;
+            m_draw_cell_size = snap.cell_size;
+            m_posted_window = {};
+            reset_camera();
+        }
+        size_t level = 0;
+        size_t levels = lod_levels(snap.columns, snap.rows, m_field_w, m_field_h);
+        while (level < levels && m_camera_scale * ((size_t) 1 << level) < 1){
+            level++;
+        }
+        lod_window want = get_visible_blocks(level, snap.columns, snap.rows);
+        const lod_window& p = m_posted_window;
+        if (level != p.level || want.x0 < p.x0 || want.x1 > p.x1 || want.y0 < p.y0 || want.y1 > p.y1){
+            m_posted_window = {level, want.x0 - std::min<size_t>(want.x0, LOD_WINDOW_MARGIN), want.y0 - std::min<size_t>(want.y0, LOD_WINDOW_MARGIN),
+                               std::min(want.x1 + LOD_WINDOW_MARGIN, lod_blocks(snap.columns, level)), std::min(want.y1 + LOD_WINDOW_MARGIN, lod_blocks(snap.rows, level))};
+            m_window_pending = true;
+        }
+
+        const lod_window& w = snap.window;
+        const lod_window view = get_visible_blocks(w.level, snap.columns, snap.rows);
+        const size_t x0 = view.x0, x1 = view.x1, y0 = view.y0, y1 = view.y1;
+        const double block = (size_t) 1 << w.level;
+        const double scale = m_camera_scale * block;            // Pixels per drawn block.
+        const size_t columns = w.x1 - w.x0;
+        m_renderer.resize(x1 - x0, y1 - y0);
+
+        for (size_t y=y0; y<y1; y++){
+            Color* row = m_renderer.get_row(y - y0);
+            for (size_t x=x0; x<x1; x++){
+                row[x - x0] = {0, 0, 0, 0};
+            }
+            if (y < w.y0 || y >= w.y1){
+                continue;
+            }
+            // The part of the row the snapshot holds.
+            size_t a = std::max(x0, w.x0), b = std::min(x1, w.x1);
+            if (w.level){
+                const uint8_t* density = snap.density.data() + ((y - w.y0) * columns);
+                for (size_t x=a; x<b; x++){
+                    row[x - x0] = m_renderer.density_colour(density[x - w.x0]);
+                }
+            }else{
+                const uint8_t* cur = snap.cells.data() + ((y - w.y0) * columns);
+                const uint32_t* births = snap.births.empty() ? nullptr : snap.births.data() + ((y - w.y0) * columns);
+                const uint32_t now = snap.birth_now;
+                for (size_t x=a; x<b; x++){
+                    size_t c = x - w.x0;
+                    if (snap.states > 2 && cur[c]){
+                        row[x - x0] = m_renderer.state_colour(cur[c], snap.states);
+                    }else if (cur[c]){
+                        row[x - x0] = m_renderer.age_colour(births ? (now - births[c]) + 1 : 1);
+                    }
                 }
             }
         }
-        if (m_live_count == 0 || m_live_count == m_grit_count){
-            stop();
-        }
-        m_ld_ratio = (double) m_live_count / m_grit_count;
+        float sx = (m_field_w / 2.0) + ((x0 - (m_camera_x / block)) * scale);
+        float sy = (m_field_h / 2.0) + ((y0 - (m_camera_y / block)) * scale);
+        BeginScissorMode(0, 0, m_field_w, m_field_h);
+        m_renderer.draw(sx, sy, scale, COL_BLACK, COL_GRAY);
+        EndScissorMode();
 }
 
-void World::draw(){
-        switch (m_state){
+// Draws the latest snapshot; stepping happens on the simulation thread.
+void World::draw(const world_snapshot& snap){
+        draw_cells(snap);
+        switch (snap.state){
             case _WAIT:
-                draw_cells();
-                draw_text("Press 'r' to run.", COL_YELLOW);
+                draw_text(snap, "Press 'r' to run.", COL_YELLOW);
                 break;
             case _RUN:
-                cycle();
-                draw_cells();
-                draw_text("Running.", COL_GREEN);
+                draw_text(snap, "Running.", COL_GREEN);
                 break;
             case _STOP:
-                draw_cells();
-                draw_text("Stopped.", COL_RED);
+                draw_text(snap, "Stopped.", COL_RED);
                 break;
         }
 }
 
-
-
+#endif
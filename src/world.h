@@ -1,25 +1,44 @@
 #pragma once
 
+// Headless builds (make bench) compile the simulation core with -DRAYLIB_ENABLED=0.
+#ifndef RAYLIB_ENABLED
+#define RAYLIB_ENABLED 1
+#endif
+
 #include <iostream>
+#include <math.h>
 #include <memory>
 #include <ostream>
+#if RAYLIB_ENABLED
 #include <raylib.h>
 #include <raymath.h>
+#endif
 #include <string.h>
 #include <string>
 #include <vector>
+#include "bit_engine.h"
 #include "c_logger.h"
+#if RAYLIB_ENABLED
 #include "colours.h"
+#include "renderer.h"
 #include "rgb_table.h"
+#endif
+#include "generations_engine.h"
+#include "hashlife.h"
+#include "lod_pyramid.h"
+#include "ltl_engine.h"
+#include "pattern_io.h"
+#include "rng.h"
+#include "rules.h"
+#include "simd_engine.h"
+#include "sparse_world.h"
+#include "state_file.h"
+#include "thread_pool.h"
+#include "tile_map.h"
 
 
-void xy_to_pos(int* pos, int x, int y, int columns);
+void xy_to_pos(int* pos, int x, int y, int columns, int rows);
 void pos_to_xy(int* x, int* y, int pos, int columns);
-uint8_t get_random_cell_value(double ld_ratio);
-uint8_t rule_perish(uint8_t vi);
-uint8_t rule_rest(uint8_t vi);
-uint8_t rule_wake(uint8_t vi);
-uint8_t rule_flip(uint8_t vi); // “birth but not survive” behavior of B/S rules.
 
 
 enum w_states{
@@ -28,6 +47,21 @@ enum w_states{
     _STOP,
 };
 
+#define HUD_H 40                    // Pixels below the field for the status lines.
+#define GRID_CELL_SIZE 12           // Default cell size in pixels.
+#define GRID_MIN 32                 // Smallest side, wider than any Larger-than-Life neighbourhood.
+#define GRID_CELLS_MAX (1UL << 28)  // Cell count cap, 16k x 16k; about 1.6 GB of buffers with ages. Snapshots hold only the view.
+#define CELL_SIZE_MAX 64
+#define CAMERA_ZOOM_STEP 1.25       // Zoom factor per mouse wheel notch.
+#define CAMERA_SCALE_MAX 64         // Pixels per cell when zoomed all the way in.
+
+#define ENGINES 3
+enum w_engines{
+    _ENGINE_SCALAR,
+    _ENGINE_BITPACK,
+    _ENGINE_SIMD
+};
+
 enum w_states_sub{
     _NONE,
     _RANDOM,
@@ -35,7 +69,55 @@ enum w_states_sub{
 };
 
 
-#define MODES 12
+// Produced by cycle() as a by-product of the step; read by the HUD, auto-stop and the bench.
+struct world_stats{
+    uint64_t generation;
+    size_t population;
+    size_t births;
+    size_t deaths;
+    size_t max_age;
+    uint64_t hash;                  // Zobrist hash of the grid, kept up to date by the steps.
+    size_t period;                  // Period of the repeating state, 0 until one is found.
+};
+
+#define HASH_HISTORY 64             // Longest period that is detected.
+#define AGE_KEEP (1UL << 31)        // Ages kept exact when the birth stamps are rebased; older cells saturate.
+
+struct hash_entry{
+    uint64_t hash;
+    size_t population;
+    uint64_t generation;
+};
+
+
+#define HUD_TEXT_LEN 255
+
+// One completed generation handed from the simulation thread to the renderer (SimThread).
+// Only the window the renderer asked for is copied, at the pyramid level it draws. The
+// HUD lines that depend on World state are formatted when the snapshot is taken, so
+// drawing reads nothing the simulation thread writes.
+struct world_snapshot{
+    size_t columns;
+    size_t rows;
+    size_t cell_size;
+    lod_window window;              // What cells, births and density hold, clamped to the grid.
+    std::vector<uint8_t> cells;     // Level 0: the cells of the window, row by row.
+    std::vector<uint8_t> density;   // Above level 0: one value per block of the window.
+    std::vector<uint32_t> births;   // Level 0 with ages enabled, else empty.
+    uint32_t birth_now;             // Stamp of this generation; age = birth_now - births[c] + 1.
+    world_stats stats;
+    int state;
+    uint64_t seed;
+    uint16_t states;                // Of the rule; above 2 cells are coloured by state.
+    size_t gens_per_tick;           // Set by SimThread; 0 at max speed.
+    double gens_per_s;              // Set by SimThread, measured.
+    char mode_text[RULE_NAME_LEN];
+    char engine_text[HUD_TEXT_LEN];
+    char prompt_text[HUD_TEXT_LEN];
+};
+
+
+#define MODES 15
 enum game_modes{
     _CONWAY,
     _REPLICATOR,
@@ -48,7 +130,10 @@ enum game_modes{
     _HIGHLIFE,
     _DAY_NIGHT,
     _MORLEY,
-    _ANNEAL
+    _ANNEAL,
+    _BOSCO,
+    _BRIANS_BRAIN,
+    _STAR_WARS
 };
 enum game_modes_full{
     _B3_S23_CONWAY,
@@ -62,7 +147,10 @@ enum game_modes_full{
     _B36_S23_HIGHLIFE,
     _B3678_S34678_DAY_NIGHT,
     _B368_S245_MORLEY,
-    _B4678_S35678_ANNEAL
+    _B4678_S35678_ANNEAL,
+    _R5_C0_M1_S34_58_B34_45_NM_BOSCO,
+    _B2_S_C3_BRIANS_BRAIN,
+    _B2_S345_C4_STAR_WARS
 };
 
 
@@ -78,41 +166,82 @@ class World{
         size_t m_field_w;
         size_t m_cell_size;
         size_t m_columns;
-        size_t m_remainder_w;
         size_t m_rows;
-        size_t m_remainder_h;
         size_t m_grit_count;
-        size_t m_live_count;
-        double m_ld_ratio;
+        size_t m_draw_cell_size;    // Size of the last drawn snapshot; render thread only.
+        size_t m_draw_columns;
+        size_t m_draw_rows;
+        double m_camera_x;          // Grid point at the centre of the field, in cells.
+        double m_camera_y;
+        double m_camera_scale;      // Pixels per cell.
+        lod_window m_posted_window; // Last window handed out by take_view_window(); render thread only.
+        bool m_window_pending;
+        lod_window m_snapshot_window;   // What snapshot() copies; simulation thread only.
+        world_stats m_stats;
         uint8_t* m_cell_value_a;
         uint8_t* m_cell_value_b;
         uint8_t m_cycle_turn;
         uint8_t* m_cell_values[2];
-        size_t* m_cell_ages;
-        size_t m_max_age;
-        uint8_t (*m_rule_array[9])(uint8_t value);
+        uint32_t* m_cell_births;    // Generation each live cell was born in, minus m_birth_base.
+        uint64_t m_birth_base;      // Moved up by rebase_births() before a stamp would overflow.
+        bool m_ages_enabled;
+        hash_entry m_history[HASH_HISTORY];
+        size_t m_history_len;
+        size_t m_history_head;
+        bool m_stop_on_period;
+        uint64_t m_seed;            // Seed of the last random fill.
+        rule_t m_rule;
+        uint8_t m_rule_table[18];
+        char m_rule_input[RULE_NAME_LEN];
+        uint8_t m_engine;
+        BitEngine m_bit_engine;
+        bool m_bit_engine_dirty;
+        bool m_cells_dirty;         // The byte grid is behind the packed rows or the unbounded plane.
+        SimdEngine m_simd_engine;
+        LtlEngine m_ltl_engine;
+        GenerationsEngine m_generations_engine;
+        ThreadPool m_pool;
+        TileMap m_tiles;
+        bool m_tiles_enabled;
+        size_t m_tiles_active;
+        HashLife m_hashlife;
+        bool m_hashlife_dirty;
+        int m_jump_log2;
+        SparseWorld m_sparse;
+        bool m_unbounded;
+        int64_t m_view_x;
+        int64_t m_view_y;
+#if RAYLIB_ENABLED
+        CellRenderer m_renderer;
+#endif
         //char* state_text[];
         uint8_t m_mode_ix;
         const char* m_mode_str;
         const char* m_new_mode_str;
 
     public:
-        World();
-        World(size_t screen_h, size_t screen_w, size_t cell_size);
+        World(size_t screen_h, size_t screen_w, size_t cell_size, size_t columns, size_t rows);
         ~World();
         void select_game_mode(uint8_t mode);
-        void get_rules_conway();
-        void get_rules_replicator();
-        void get_rules_seeds();
-        void get_rules_b25_s4();
-        void get_rules_life_without_death();
-        void get_rules_34_life();
-        void get_rules_2x2();
-        void get_rules_highlife();
-        void get_rules_day_night();
-        void get_rules_morley();
-        void get_rules_anneal();
-        void get_rules_diamoeba();
+        void set_rule(const rule_t& rule);
+        void drop_states(uint16_t states);
+        bool set_rule_string(const char* text);
+        void rule_input_push(char c);
+        void rule_input_pop();
+        void set_engine(uint8_t engine);
+        void next_engine();
+        void set_threads(size_t threads);
+        size_t get_threads();
+        void toggle_tiles();
+        void set_jump_log2(int log2_steps);
+        void change_jump_log2(int delta);
+        void set_hashlife_node_limit(size_t nodes);
+        void jump();
+        void toggle_unbounded();
+        void reload_sparse();
+        void pan(int64_t dx, int64_t dy);
+        void cycle_unbounded();
+        void cycle_ltl();
         void prompt_mode();
         void prompt_digit();
         void set_mode(int value);
@@ -125,19 +254,65 @@ class World{
         void gradient();
         void randomize_cells(uint8_t ld_value);
         void setup_cells(double ld_ratio);
+        void fill_random(const uint32_t* cutoffs);
+        void set_seed(uint64_t seed);
+        uint64_t get_seed();
         void set_cell(size_t index, int value);
+        bool load_pattern(const char* path, int64_t x, int64_t y);
+        bool save_pattern(const char* path);
+        bool save_state(const char* path);
+        bool load_state(const char* path);
+        size_t get_cell_age(size_t index);
+        void stamp_births();
+        uint32_t birth_stamp();
+        void rebase_births();
+        void set_ages_enabled(bool enabled);
+        void count_tile(size_t tile);
+        void sum_stats();
+        void recount_stats();
+        void reset_history();
+        void detect_period();
+        void toggle_stop_on_period();
+        const world_stats& get_stats();
         int get_neighbour_value_count(size_t index);
         void cycle();
+        void cycle_torus();
+        void cycle_scalar(size_t y0, size_t y1, size_t x0, size_t x1);
+        void cycle_simd(size_t y0, size_t y1, size_t x0, size_t x1);
+        bool cycle_tile(size_t tx, size_t ty);
+        bool cycle_tile_packed(size_t tx, size_t ty);
+        void sync_cells();
+        void sync_view();
+        bool update_tile(size_t tx, size_t ty);
         size_t get_cell_count();
+        size_t get_columns();
+        size_t get_rows();
+        size_t get_cell_size();
+        bool resize(size_t columns, size_t rows, size_t cell_size, bool keep);
+        void change_cell_size(int delta);
+        const uint8_t* get_cells();
+        const char* get_engine_name();
+        const char* get_rule_name();
+        const rule_t& get_rule();
+        void set_view_window(const lod_window& window);
+        void snapshot(world_snapshot& out);
+        void copy_grid(std::vector<uint8_t>& cells, std::vector<uint32_t>& births, uint32_t* birth_now);
         int get_cell_index_from_pos(int x, int y);
-        void act_on_mouse(int mouse_button);
-        void draw_colour_rgb(size_t x, size_t y, int colour);
-        void draw_colour(size_t x, size_t y, int colour);
         void print_age_grit();
         void print_cell_grit();
-        void draw();
-        void draw_cells();
-        void draw_text(const char* text, Color colour);
+#if RAYLIB_ENABLED
+        int get_mouse_cell();
+        void reset_camera();
+        void clamp_camera();
+        void zoom_camera(float steps, int x, int y);
+        void drag_camera(float dx, float dy);
+        lod_window get_visible_blocks(size_t level, size_t columns, size_t rows);
+        bool take_view_window(lod_window* window);
+        void draw_colour(size_t x, size_t y, int colour);
+        void draw(const world_snapshot& snap);
+        void draw_cells(const world_snapshot& snap);
+        void draw_text(const world_snapshot& snap, const char* text, Color colour);
+#endif
 };
 
 